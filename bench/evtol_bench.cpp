@@ -0,0 +1,332 @@
+/**
+ * @brief   eVtol Simulation Benchmarks
+ * @details This file contains the microbenchmarks for the simulation kernels of the eVtol simulation problem from
+ *          Joby Avation: state machine step, in-flight integration, charging step, fault arming and dispatch,
+ *          flight data recording (text and binary) and an end-to-end event engine run. Every benchmark runs at
+ *          several fleet sizes. Like Google Benchmark, the iteration count doubles until a run takes at least
+ *          the minimum time. Results are printed as CSV, one row per benchmark and fleet size, so runs of two
+ *          versions can be diffed for throughput regressions.
+ *          Usage: evtol_bench [-n sizes] [-f filter] [-m min_seconds] [-o results.csv]
+ *
+ * @author  Deepak E Kapure
+ * @date    07-02-2025
+ *
+ */
+
+#include "../includes/sim_context.hpp"
+#include "../includes/ac_simul.hpp"
+#include "../includes/event_engine.hpp"
+#include "../includes/instrument.hpp"
+#include <sstream>
+#include <cstring>
+
+#define BENCH_SEED              (42)
+#define BENCH_MIN_TIME          (0.25)           // seconds per benchmark and fleet size
+#define BENCH_MAX_ITERATIONS    (1L << 24)
+#define BENCH_FDR_SAMPLES       (8)              // samples per iteration of the recorder benchmarks
+#define BENCH_E2E_HOURS         (3)
+#define BENCH_E2E_MAX_FLEET     (100000)         // larger fleets are skipped by the end-to-end benchmark
+
+/**
+ * @brief A benchmark. The function runs iters iterations on a fleet of the given size
+ *        and returns the time in nsec of the measured part, setup may be excluded.
+ *
+ * @var name Benchmark name.
+ * @var run Benchmark function.
+ * @var items Items processed per iteration for a fleet size, the throughput unit.
+ * @var max_fleet Largest fleet size the benchmark runs on.
+ */
+typedef struct BENCHMARK {
+    const char *name;
+    function<double(int fleet, long iters)> run;
+    function<double(int fleet)> items;
+    int max_fleet;
+} _benchmark;
+
+/**
+ * @brief Result of one benchmark at one fleet size.
+ */
+typedef struct BENCH_RESULT {
+    string name;
+    int fleet;
+    long iterations;
+    double ns;
+    double items;
+} _bench_result;
+
+static inline double now_ns() {
+    return (double)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Makes the compiler assume v is read here, so the work computing it is neither
+ *        dropped nor moved out of the measured part.
+ */
+template <typename T>
+static inline void do_not_optimize(const T &v) {
+    asm volatile("" : : "r,m"(v) : "memory");
+}
+
+/**
+ * @brief Creates a seeded fleet on the event engine settings, without logs or recorder.
+ *
+ * @param ctx Pointer to the context to fill.
+ * @param fleet Number of aircraft.
+ *
+ * @return None
+ */
+static void make_fleet(_sim_context *ctx, int fleet) {
+    _sim_config cfg;
+    default_sim_config(&cfg);
+    cfg.aircrafts = fleet;
+    cfg.chargers = max(1, fleet / 10);
+    cfg.seed = BENCH_SEED;
+    cfg.log_inputs = false;
+    init_sim_context(ctx, cfg);
+    create_aircrafts(ctx, &paramter_map, TOTAL_CATEGORIES);
+}
+
+/**
+ * @brief aircraft::state_machine, one in-flight step of every aircraft.
+ */
+static double bench_state_machine(int fleet, long iters) {
+    _sim_context ctx;
+    make_fleet(&ctx, fleet);
+    launch_fleet(&ctx);
+    milliseconds dt(SERVICE_INTERVAL);
+    double start = now_ns();
+    for(long i=0; i<iters; i++) {
+        for(int ac=0; ac<fleet; ac++) {
+            ctx.fleet[ac]->state_machine(dt, &ctx.mailbox[ac], &ctx.charge_queue, &ctx.live);
+        }
+    }
+    double ns = now_ns() - start;
+    delete_aircrafts(&ctx);
+    return ns;
+}
+
+/**
+ * @brief update_ac_stats, the in-flight integration kernel over the whole fleet.
+ */
+static double bench_integrate_flight(int fleet, long iters) {
+    _sim_context ctx;
+    make_fleet(&ctx, fleet);
+    launch_fleet(&ctx);
+    milliseconds dt(SERVICE_INTERVAL);
+    double start = now_ns();
+    for(long i=0; i<iters; i++) {
+        fleet_integrate_flight(&ctx.store, 0, fleet, dt);
+    }
+    double ns = now_ns() - start;
+    delete_aircrafts(&ctx);
+    return ns;
+}
+
+/**
+ * @brief charging_update, every aircraft requests a charge and the pool (fleet / 10
+ *        chargers) serves all sessions to the end. Resetting the pool is not measured.
+ */
+static double bench_charging(int fleet, long iters) {
+    _sim_context ctx;
+    make_fleet(&ctx, fleet);
+    milliseconds full(2 * (long)SIMULATION_FACTOR);             // longer than any charge
+    double ns = 0;
+    for(long i=0; i<iters; i++) {
+        ctx.chargers.init(ctx.cfg.chargers, ctx.cfg.policy);
+        for(auto &mb: ctx.mailbox) {
+            mb.charge.store(0, memory_order_relaxed);
+        }
+        double start = now_ns();
+        for(int ac=0; ac<fleet; ac++) {
+            _c_queue_entry e = {ac, (int)(SIMULATION_FACTOR / 2) + ac % 1000, 2, CHARGE_REQUEST, NO_CHARGER};
+            ctx.charge_queue.push(e);
+        }
+        charging_update(&ctx, milliseconds(0), nullptr);
+        while(ctx.chargers.waiting_count() > 0) {
+            charging_update(&ctx, full, nullptr);
+        }
+        charging_update(&ctx, full, nullptr);
+        ns += now_ns() - start;
+    }
+    delete_aircrafts(&ctx);
+    return ns;
+}
+
+/**
+ * @brief fault_injection, arming the fault process of every aircraft.
+ */
+static double bench_fault_injection(int fleet, long iters) {
+    _sim_context ctx;
+    make_fleet(&ctx, fleet);
+    double start = now_ns();
+    for(long i=0; i<iters; i++) {
+        fault_injection(&probablity_map, &ctx);
+    }
+    double ns = now_ns() - start;
+    delete_aircrafts(&ctx);
+    return ns;
+}
+
+/**
+ * @brief Fault dispatch, drawing and dispatching every fault of a 3 hour run. Arming is not measured.
+ */
+static double bench_fault_dispatch(int fleet, long iters) {
+    _sim_context ctx;
+    make_fleet(&ctx, fleet);
+    double ns = 0;
+    size_t sink = 0;
+    for(long i=0; i<iters; i++) {
+        fault_injection(&probablity_map, &ctx);
+        double start = now_ns();
+        ctx.faults.dispatch_due(milliseconds::max(), [&sink](int ac) { sink += ac; });
+        do_not_optimize(sink);
+        ns += now_ns() - start;
+    }
+    delete_aircrafts(&ctx);
+    return ns;
+}
+
+/**
+ * @brief data_recorder_service path, snapshots of the whole fleet encoded and written by
+ *        the recorder thread to /dev/null, writer start and drain included.
+ */
+static double bench_fdr(int fleet, long iters, _fdr_format format) {
+    _sim_context ctx;
+    make_fleet(&ctx, fleet);
+    ctx.cfg.fdr_format = format;
+    double ns = 0;
+    for(long i=0; i<iters; i++) {
+        ofstream out("/dev/null", ios::out | ios::binary);
+        double start = now_ns();
+        start_fdr_writer(&ctx, out);
+        for(int s=1; s<=BENCH_FDR_SAMPLES; s++) {
+            record_flight_data(&ctx, milliseconds(s * FDR_INTERVAL));
+        }
+        stop_fdr_writer(&ctx);
+        ns += now_ns() - start;
+    }
+    delete_aircrafts(&ctx);
+    return ns;
+}
+
+/**
+ * @brief End-to-end scenario, a seeded 3 hour run on the event engine without recorder.
+ */
+static double bench_end_to_end(int fleet, long iters) {
+    _sim_context ctx;
+    double ns = 0;
+    for(long i=0; i<iters; i++) {
+        double start = now_ns();
+        make_fleet(&ctx, fleet);
+        ctx.cfg.sim_hours = BENCH_E2E_HOURS;
+        fault_injection(&probablity_map, &ctx);
+        des_simulation(&ctx, milliseconds((long)(BENCH_E2E_HOURS * SIMULATION_FACTOR)));
+        _sim_metrics m;
+        compute_sim_metrics(&ctx, &m);
+        ns += now_ns() - start;
+        delete_aircrafts(&ctx);
+    }
+    return ns;
+}
+
+/**
+ * @brief Runs a benchmark, doubling the iterations until it takes at least min_time.
+ *
+ * @param b Benchmark.
+ * @param fleet Fleet size.
+ * @param min_time Minimum measured time in seconds.
+ *
+ * @return Result of the last run.
+ */
+static _bench_result run_benchmark(const _benchmark &b, int fleet, double min_time) {
+    _bench_result r = {b.name, fleet, 1, 0, 0};
+    while(true) {
+        r.ns = b.run(fleet, r.iterations);
+        if((r.ns >= min_time * 1e9) || (r.iterations >= BENCH_MAX_ITERATIONS)) {
+            break;
+        }
+        double grow = (r.ns > 0) ? (min_time * 1e9 * 1.2 / r.ns) : 2.0;
+        r.iterations = (long)(r.iterations * min(max(grow, 2.0), 100.0));
+    }
+    r.items = b.items(fleet) * r.iterations;
+    return r;
+}
+
+/**
+ * @brief Parses a comma separated list of fleet sizes.
+ */
+static bool parse_sizes(const char *arg, vector<int> *sizes) {
+    sizes->clear();
+    stringstream ss(arg);
+    string tok;
+    while(getline(ss, tok, ',')) {
+        int n = atoi(tok.c_str());
+        if(n < 1) {
+            return false;
+        }
+        sizes->push_back(n);
+    }
+    return !sizes->empty();
+}
+
+int main(int argc, char *argv[]) {
+    vector<int> sizes = {20, 1000, 100000, 1000000};
+    string filter;
+    string out_file;
+    double min_time = BENCH_MIN_TIME;
+    for(int i=1; i<argc; i++) {
+        if((strcmp(argv[i], "-n") == 0) && (i+1 < argc) && parse_sizes(argv[i+1], &sizes)) {
+            i++;
+        } else if((strcmp(argv[i], "-f") == 0) && (i+1 < argc)) {
+            filter = argv[++i];
+        } else if((strcmp(argv[i], "-m") == 0) && (i+1 < argc) && (atof(argv[i+1]) > 0)) {
+            min_time = atof(argv[++i]);
+        } else if((strcmp(argv[i], "-o") == 0) && (i+1 < argc)) {
+            out_file = argv[++i];
+        } else {
+            cerr << "Usage: " << argv[0] << " [-n sizes] [-f filter] [-m min_seconds] [-o results.csv]" << endl;
+            return 1;
+        }
+    }
+    INSTR_ENABLE(false);
+
+    auto per_aircraft = [](int fleet) { return (double)fleet; };
+    vector<_benchmark> benchmarks = {
+        { "state_machine",    bench_state_machine,    per_aircraft, 1000000 },
+        { "integrate_flight", bench_integrate_flight, per_aircraft, 1000000 },
+        { "charging_update",  bench_charging,         per_aircraft, 1000000 },
+        { "fault_injection",  bench_fault_injection,  per_aircraft, 1000000 },
+        { "fault_dispatch",   bench_fault_dispatch,   per_aircraft, 1000000 },
+        { "fdr_text",         [](int f, long n) { return bench_fdr(f, n, FDR_TEXT); },
+                              [](int f) { return (double)f * BENCH_FDR_SAMPLES; }, 1000000 },
+        { "fdr_binary",       [](int f, long n) { return bench_fdr(f, n, FDR_BINARY_DELTA); },
+                              [](int f) { return (double)f * BENCH_FDR_SAMPLES; }, 1000000 },
+        { "end_to_end",       bench_end_to_end,
+                              [](int f) { return (double)f * BENCH_E2E_HOURS; }, BENCH_E2E_MAX_FLEET }
+    };
+
+    ostringstream csv;
+    csv << "benchmark,fleet,iterations,total_ns,ns_per_item,items_per_s\n";
+    cout << csv.str() << flush;
+    for(auto &b: benchmarks) {
+        if(!filter.empty() && (string(b.name).find(filter) == string::npos)) {
+            continue;
+        }
+        for(int fleet: sizes) {
+            if(fleet > b.max_fleet) {
+                continue;
+            }
+            _bench_result r = run_benchmark(b, fleet, min_time);
+            ostringstream line;
+            line << r.name << "," << r.fleet << "," << r.iterations << "," << (long long)r.ns << ","
+                 << (r.ns / r.items) << "," << (r.items / (r.ns * 1e-9)) << "\n";
+            cout << line.str() << flush;
+            csv << line.str();
+        }
+    }
+    if(!out_file.empty()) {
+        ofstream out(out_file);
+        out << csv.str();
+    }
+    return 0;
+}
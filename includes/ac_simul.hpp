@@ -1,31 +1,20 @@
 #ifndef _AIRCRAFT_SIMULATION_
 #define _AIRCRAFT_SIMULATION_
 
-#include "../includes/definitions.hpp"
+#include "../includes/sim_context.hpp"
+#include "../includes/worker_pool.hpp"
 #include <thread>
-#include <barrier>
 
-/**
- * @brief Represents the live status of a charger.
- *
- * @var status Current charger status.
- * @var ac_num Aircraft number currently charging.
- * @var c_time_left Remaining charging time.
- */
-typedef struct CHARGER_LIVE_INFO {
-    _charger_stat status;
-    int ac_num;
-    int c_time_left;
-} _c_live_info;
-
-void spawn_threads(vector<thread> *th_pool, int total_ac, aircraft **ac_array, queue<_c_queue_entry*> *cq);
-void aircraft_simul(int tid, aircraft *plane, queue<_c_queue_entry*> *cq);
-void charging_service(charger *ch, queue<_c_queue_entry*> *cq);
-void set_fault_sig(int ac, int state);
-int get_fault_sig(int ac);
-void set_terminate_sig(bool state);
-int get_fault_sig();
-void set_charge_sig(int ac, int state);
-int get_charge_sig(int ac);
+void aircraft_simul(_sim_context *ctx, int begin, int end, milliseconds interval);
+void simulation_service(worker_pool *pool, _sim_context *ctx);
+void launch_fleet(_sim_context *ctx);
+void charging_service(_sim_context *ctx);
+int charging_update(_sim_context *ctx, milliseconds elapsed, vector<int> *changed);
+int charging_update_pool(_sim_context *ctx, charger *pool, mpsc_queue<_c_queue_entry> *cq, milliseconds elapsed, vector<int> *changed);
+_c_live_info get_charger_live(_sim_context *ctx, _charger_id id);
+void post_fault(_sim_context *ctx, int ac);
+void set_terminate_sig(_sim_context *ctx, bool state);
+int get_terminate_sig(_sim_context *ctx);
+int get_charge_sig(_sim_context *ctx, int ac);
 
 #endif //_AIRCRAFT_SIMULATION_
\ No newline at end of file
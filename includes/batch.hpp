@@ -0,0 +1,43 @@
+#ifndef _BATCH_
+#define _BATCH_
+
+#include "../includes/sim_context.hpp"
+#include "../includes/online_stats.hpp"
+#include <mutex>
+#include <vector>
+
+#define BATCH_QUANTILES         (3)              // p5, p50, p95
+
+/**
+ * @brief Online summary of one metric over all replications.
+ *
+ * @var stats Count, mean, variance, min and max.
+ * @var quantile Streaming p5, p50 and p95 estimates.
+ */
+typedef struct BATCH_SERIES {
+    running_stats stats;
+    p2_quantile quantile[BATCH_QUANTILES];
+} _batch_series;
+
+/**
+ * @brief Aggregated results of a batch run.
+ *
+ * @var replications Replications aggregated.
+ * @var seconds Wall time of the batch.
+ * @var series Summary per company and _sim_metric.
+ */
+typedef struct BATCH_RESULT {
+    int replications;
+    double seconds;
+    _batch_series series[TOTAL_CATEGORIES][TOTAL_METRICS];
+} _batch_result;
+
+uint64_t replication_seed(uint64_t master, int replication);
+void run_replication(_sim_context *ctx, const _sim_config &cfg, _ac_map *map, _prob_map *pmap, _sim_metrics *m);
+void run_branch(_sim_context *ctx, const vector<char> &ckpt, const _sim_config &cfg, _sim_metrics *m);
+void run_batch_points(const vector<_sim_config> &points, int reps, _ac_map *map, _prob_map *pmap, vector<_batch_result> *res,
+                      const vector<char> *branch_from);
+void run_batch(const _sim_config &cfg, _ac_map *map, _prob_map *pmap, _batch_result *res);
+void write_batch_results(_batch_result *res, ostream &out);
+
+#endif //_BATCH_
@@ -0,0 +1,58 @@
+#ifndef _CHECKPOINT_
+#define _CHECKPOINT_
+
+#include "../includes/sim_context.hpp"
+#include <vector>
+#include <string>
+
+/**
+ * @brief Checkpoint of a run on the event engine, the complete simulation state at one
+ *        simulation time. Restoring it continues the run bit exactly.
+ *
+ *        File layout (host byte order, same build only):
+ *        _ckpt_header
+ *        configuration                           simulation settings of the run
+ *        specification x companies               company parameters and fault probability
+ *        uint8_t x aircrafts                     company of each aircraft
+ *        fleet store                             flight time, miles, battery, soc, status and limit per aircraft
+ *        aircraft state x aircrafts              faults, charger, charge and maintenance timers, booked statistics
+ *        mailboxes                               faults and charger per aircraft
+ *        charger pool                            usage, sessions and the free, busy and waiting heaps
+ *        charge queue                            messages not yet taken by the charging service
+ *        fault schedule                          random stream of every aircraft and the pending faults
+ *        live statistics                         raw counters
+ *        event engine                            event heap with the next sample, sequence number, per aircraft clocks and epochs
+ */
+#define CKPT_MAGIC              "EVTOLCKP"
+#define CKPT_MAGIC_LEN          (8)
+#define CKPT_VERSION            (3)
+
+/**
+ * @brief Checkpoint file header.
+ *
+ * @var magic CKPT_MAGIC, not null terminated.
+ * @var version CKPT_VERSION.
+ * @var aircrafts Fleet size.
+ * @var bytes Size of the whole checkpoint, a truncated file is rejected.
+ * @var time Simulation msec of the snapshot.
+ * @var end_time Simulation msec at which the run ends.
+ */
+typedef struct CKPT_HEADER {
+    char magic[CKPT_MAGIC_LEN];
+    uint32_t version;
+    uint32_t aircrafts;
+    uint64_t bytes;
+    int64_t time;
+    int64_t end_time;
+} _ckpt_header;
+
+void save_sim_context(_sim_context *ctx, milliseconds now, milliseconds end_time, ckpt_writer *w);
+void finish_checkpoint(ckpt_writer *w);
+bool restore_sim_context(_sim_context *ctx, ckpt_reader *r, const _sim_config &run, milliseconds *now, milliseconds *end_time);
+bool read_checkpoint_config(const vector<char> &ckpt, _sim_config *cfg, milliseconds *now, string *err);
+bool is_what_if(const _sim_config &saved, const _sim_config &cfg);
+void apply_what_if(_sim_context *ctx, const _sim_config &branch, milliseconds now);
+bool write_checkpoint_file(const string &path, ckpt_writer &w);
+bool read_checkpoint_file(const string &path, vector<char> *out, string *err);
+
+#endif //_CHECKPOINT_
@@ -0,0 +1,149 @@
+#ifndef _CKPT_STREAM_
+#define _CKPT_STREAM_
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * @class ckpt_writer
+ * @brief Byte buffer a checkpoint is serialized into. Values are copied in host byte
+ *        order, vectors are prefixed with their length.
+ */
+class ckpt_writer {
+    private:
+        vector<char> buf;
+    public:
+        void put_bytes(const void *p, size_t n) {
+            const char *b = static_cast<const char *>(p);
+            buf.insert(buf.end(), b, b + n);
+        }
+
+        template<typename T>
+        void put(const T &v) {
+            static_assert(is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+            put_bytes(&v, sizeof(T));
+        }
+
+        template<typename T>
+        void put_array(const T *v, size_t n) {
+            static_assert(is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+            put_bytes(v, n * sizeof(T));
+        }
+
+        template<typename T>
+        void put_vector(const vector<T> &v) {
+            put<uint64_t>(v.size());
+            put_array(v.data(), v.size());
+        }
+
+        /**
+         * @brief Writes a vector of records with padding field by field, through the
+         *        put_record() of the record type, so no uninitialized padding byte is
+         *        copied and the same state always gives the same bytes.
+         */
+        template<typename T>
+        void put_records(const vector<T> &v) {
+            put<uint64_t>(v.size());
+            for(const T &e: v) {
+                put_record(this, e);
+            }
+        }
+
+        /**
+         * @brief Overwrites a value written earlier, e.g. a length known only at the end.
+         *
+         * @param offset Byte offset of the value.
+         * @param v New value.
+         */
+        template<typename T>
+        void put_at(size_t offset, const T &v) {
+            static_assert(is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+            if(offset + sizeof(T) <= buf.size()) {
+                memcpy(buf.data() + offset, &v, sizeof(T));
+            }
+        }
+
+        const vector<char> &bytes() { return buf; }
+        size_t size() { return buf.size(); }
+};
+
+/**
+ * @class ckpt_reader
+ * @brief Reads a checkpoint back from a byte buffer it does not own, so many branches can
+ *        restore from one copy. A read past the end or of an implausible length fails the
+ *        reader instead of throwing; every later read fails too, check good() at the end.
+ */
+class ckpt_reader {
+    private:
+        const char *data;
+        size_t len;
+        size_t pos;
+        bool ok;
+    public:
+        ckpt_reader(const char *d, size_t n) : data(d), len(n), pos(0), ok(true) {}
+
+        bool get_bytes(void *p, size_t n) {
+            ok = ok && (n <= len - pos);
+            if(ok) {
+                memcpy(p, data + pos, n);
+                pos += n;
+            }
+            return ok;
+        }
+
+        template<typename T>
+        bool get(T *v) {
+            static_assert(is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+            return get_bytes(v, sizeof(T));
+        }
+
+        template<typename T>
+        bool get_array(T *v, size_t n) {
+            static_assert(is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+            ok = ok && (n <= (len - pos) / max(sizeof(T), (size_t)1));
+            return get_bytes(v, n * sizeof(T));
+        }
+
+        template<typename T>
+        bool get_vector(vector<T> *v) {
+            uint64_t n = 0;
+            if(get(&n)) {
+                ok = (n <= (len - pos) / max(sizeof(T), (size_t)1));
+            }
+            if(ok) {
+                v->resize(n);
+                get_array(v->data(), n);
+            }
+            return ok;
+        }
+
+        /**
+         * @brief Reads a vector written by ckpt_writer::put_records() through the
+         *        get_record() of the record type.
+         */
+        template<typename T>
+        bool get_records(vector<T> *v) {
+            uint64_t n = 0;
+            if(get(&n)) {
+                ok = (n <= len - pos);                  // every record takes at least a byte
+            }
+            if(ok) {
+                v->resize(n);
+                for(size_t k=0; ok && (k<n); k++) {
+                    get_record(this, &(*v)[k]);
+                }
+            }
+            return ok;
+        }
+
+        bool good() { return ok; }
+        size_t remaining() { return len - pos; }
+};
+
+#endif //_CKPT_STREAM_
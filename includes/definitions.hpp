@@ -1,30 +1,54 @@
 #ifndef _DEFINITIONS_
 #define _DEFINITIONS_
 
-#include <iostream>
-#include <queue>
 #include <map>
-#include <thread>
-#include <fstream>
-#include "../includes/timer.hpp"
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <atomic>
+#include <algorithm>
+#include "../includes/mpsc_queue.hpp"
+#include "../includes/live_stats.hpp"
+#include "../includes/ckpt_stream.hpp"
+#include "../includes/fdr_format.hpp"
 
 /**
- * @brief Simulation macros. Set these for changing simulation conditions
+ * @brief Simulation defaults. Fleet size and simulated hours are set at runtime (-n / -t),
+ *        these are only used when no option is given.
  * 
  */
-#define AIRCRAFTS                   (20)  // -- Set this for aircrafts                 
-#define SIMULATION_TIME_HRS         (3)   // -- Set this for hours 
+#define DEFAULT_AIRCRAFTS           (20)  // -- Default aircrafts
+#define DEFAULT_SIMULATION_HRS      (3)   // -- Default hours 
+#define DEFAULT_CHARGERS            (3)   // -- Default chargers
+#define DEFAULT_SITE_MILES          (10.0)  // -- Default vertiport spacing of the network model
 
 // Derived and system macros
-#define TOTAL_AIRCRAFTS             ((AIRCRAFTS < 5) ? (5) : (AIRCRAFTS))    // MINIMUM 5 AIRCRAFTS     
-#define SIMULATION_FACTOR           (60000.0)                                // 1 HOUR = 1 MINUTE SIMULATION = 60000 MILLISEC
-#define DOWNTIME_HOURS              (0.5)
+#define MIN_AIRCRAFTS               (5)                                      // MINIMUM 5 AIRCRAFTS (one per company)
+#define SIMULATION_FACTOR           (60000.0)                                // 1 HOUR = 60000 MILLISEC OF SIMULATION TIME
+#define SIM_MS_TO_HOURS             (1.0 / SIMULATION_FACTOR)                // simulation msec to simulated hours
+#define HOUR_MSEC                   (3600000.0)                              // 1 HOUR = 3600000 MILLISEC OF REAL TIME
+#define DEFAULT_TIME_SCALE          (HOUR_MSEC / SIMULATION_FACTOR)          // simulated per wall second with -r, 1 HOUR = 1 MINUTE
+#define TIME_SCALE_MAX              (0.0)                                    // -x max, services run back to back on a virtual clock
+#define DOWNTIME_HOURS              (0.5)                                    // default, set at runtime by the sweep
 #define DOWNTIME_SIMUL_TIME         (DOWNTIME_HOURS * SIMULATION_FACTOR)     //msec to wait in simulation
 #define HRS_TO_MINUTES              (60)
-#define REAL_TO_REEL_TIME_FACTOR    (0.00001666)         
-#define BATTERY_SOC_THREASHOLD      (10)
+#define BATTERY_SOC_THREASHOLD      (10)                                     // default, set at runtime by the sweep
+#define FDR_INTERVAL                (2000)                                   // flight data recorder interval in msec
+#define SERVICE_INTERVAL            (50)                                     // fleet step interval in msec
+#define CHARGING_INTERVAL           (25)                                     // lower than simulation service to reduce downtime
+#define FAULT_SERVICE_INTERVAL      (20)                                     // fault service interval in msec
+#define DRIFT_WARN_TICKS            (4)                                      // fleet steps behind the clock before the host counts as lagging
+#define CHARGE_QUEUE_PER_AIRCRAFT   (2)                                      // charge queue slots per aircraft
+#define MAX_SITES                   (4096)                                   // vertiports of the network model
+#define CACHE_LINE_SIZE             (64)
+#define RNG_STREAM_GLOBAL           (1ULL << 32)                             // aircraft n draws from stream n, run wide draws from here up
+#define RNG_STREAM_FLEET_MIX        (RNG_STREAM_GLOBAL + 0)
+#define RNG_STREAM_ROUTE            (RNG_STREAM_GLOBAL + (1ULL << 30))      // + aircraft number, network destinations
+#define RNG_STREAM_REPLICATION      (RNG_STREAM_GLOBAL + (1ULL << 31))      // + replication number, batch seeds
 
 using namespace std;
+using namespace std::chrono;
 
 // Aircraft companies
 typedef enum COMPANY {
@@ -36,6 +60,9 @@ typedef enum COMPANY {
     TOTAL_CATEGORIES
 } _ac_type;
 
+// Live per company statistics
+typedef live_stats<TOTAL_CATEGORIES> _fleet_live_stats;
+
 // Aircraft status
 typedef enum STATUS {
     STANDBY=-1,
@@ -53,13 +80,23 @@ typedef enum {
     BUSY_CHARGING=2
 } _charger_stat;
 
-// Chargers
-typedef enum CHARGER {
-    NO_CHARGER=0,
-    CHARGER_1=1,
-    CHARGER_2=2,
-    CHARGER_3=3
-} _charger_id;
+// Chargers are numbered 1..N, N is set at runtime (-c)
+typedef int _charger_id;
+#define NO_CHARGER                  (0)
+
+// Order in which waiting aircraft are dispatched to free chargers
+typedef enum DISPATCH_POLICY {
+    DISPATCH_FIFO=0,                // first come first served
+    DISPATCH_SHORTEST_CHARGE=1,     // shortest remaining charge first
+    DISPATCH_PASSENGERS=2           // highest passenger capacity first
+} _dispatch_policy;
+
+// Messages on the charge queue
+typedef enum CHARGE_QUEUE_MSG {
+    CHARGE_REQUEST=0,               // aircraft asks for a charger
+    CHARGER_RELEASE=1,              // aircraft faulted while charging, free its charger
+    CHARGE_CANCEL=2                 // aircraft faulted while queued, drop its request
+} _c_queue_msg;
 
 /**
  * @brief Stores information and usage history of a charger.
@@ -80,12 +117,115 @@ typedef struct CHARGER_INFO {
  *
  * @var ac_num Aircraft number associated with this entry.
  * @var charge_time Charging duration required (in milliseconds or hours).
+ * @var passengers Passenger capacity of the aircraft, used by DISPATCH_PASSENGERS.
+ * @var msg Charge request or charger release.
+ * @var c_id Charger to release, CHARGER_RELEASE only.
  */
 typedef struct CHARGE_QUEUE_ENTRY {
     int ac_num;
     int charge_time;
+    int passengers;
+    _c_queue_msg msg;
+    _charger_id c_id;
 } _c_queue_entry;
 
+/**
+ * @brief Per aircraft mailbox for cross-thread signalling. Each mailbox owns a full cache
+ *        line, so a service writing to one aircraft never invalidates its neighbours.
+ *        The fault -> maintenance -> charger release handshake uses explicit messages:
+ *        the fault service posts to faults, the aircraft consumes them and, if it was
+ *        charging, posts a CHARGER_RELEASE on the charge queue for the charging service,
+ *        if it was queued a CHARGE_CANCEL.
+ *
+ * @var faults Faults posted by the fault service, not yet taken by the aircraft.
+ * @var charge Charger the aircraft is assigned to, 0 when not charging. Written by the charging service.
+ */
+typedef struct alignas(CACHE_LINE_SIZE) AC_MAILBOX {
+    atomic<int> faults{0};
+    atomic<int> charge{0};
+} _ac_mailbox;
+
+/**
+ * @brief Represents the live status of a charger.
+ *
+ * @var status Current charger status.
+ * @var ac_num Aircraft number currently charging.
+ * @var c_time_left Remaining charging time.
+ */
+typedef struct CHARGER_LIVE_INFO {
+    _charger_stat status;
+    int ac_num;
+    int c_time_left;
+} _c_live_info;
+
+/**
+ * @brief Aircraft waiting for a charger, ordered by the dispatch policy.
+ *
+ * @var key Dispatch key, lower is served first.
+ * @var seq Arrival order, breaks ties so equal keys are served first come first served.
+ * @var entry Charge request.
+ */
+typedef struct CHARGE_WAIT_ENTRY {
+    long key;
+    unsigned long seq;
+    _c_queue_entry entry;
+} _c_wait_entry;
+
+// Checkpoint a waiting aircraft field by field, its tail padding is never written
+static inline void put_record(ckpt_writer *w, const _c_wait_entry &e) {
+    w->put(e.key);
+    w->put(e.seq);
+    w->put(e.entry);
+}
+static inline bool get_record(ckpt_reader *r, _c_wait_entry *e) {
+    r->get(&e->key);
+    r->get(&e->seq);
+    return r->get(&e->entry);
+}
+
+/**
+ * @brief Ordering for the waiting aircraft. Lowest key first, ties broken by arrival order.
+ */
+struct _c_wait_later {
+    bool operator()(const _c_wait_entry &a, const _c_wait_entry &b) const {
+        return (a.key == b.key) ? (a.seq > b.seq) : (a.key > b.key);
+    }
+};
+
+/**
+ * @brief Running charge session, ordered by finish time in the busy heap.
+ *
+ * @var finish_at Pool time at which the session ends.
+ * @var id Charger id.
+ * @var session Session number of the charger, older sessions are stale.
+ */
+typedef struct CHARGE_SESSION {
+    long finish_at;
+    _charger_id id;
+    unsigned long session;
+} _c_session;
+
+// Checkpoint a running session field by field, the padding after id is never written
+static inline void put_record(ckpt_writer *w, const _c_session &s) {
+    w->put(s.finish_at);
+    w->put(s.id);
+    w->put(s.session);
+}
+static inline bool get_record(ckpt_reader *r, _c_session *s) {
+    r->get(&s->finish_at);
+    r->get(&s->id);
+    return r->get(&s->session);
+}
+
+/**
+ * @brief Ordering for the busy heap. Earliest finish first, ties broken by charger id.
+ */
+struct _c_session_later {
+    bool operator()(const _c_session &a, const _c_session &b) const {
+        return (a.finish_at == b.finish_at) ? (a.id > b.id) : (a.finish_at > b.finish_at);
+    }
+};
+
 /**
  * @brief Contains static information about an aircraft.
  *
@@ -110,73 +250,228 @@ typedef struct AC_INFO {
 // Definitions for maps
 typedef map<_ac_type, vector<int>> _ac_map;
 typedef map<_ac_type, double> _prob_map;
-typedef map<milliseconds, int> _fault_map;
+
+/**
+ * @brief Specification of an aircraft company, the single source of the company parameters.
+ *
+ * @var name Display name.
+ * @var speed Cruise speed in miles per hour.
+ * @var batt_cap Battery capacity in watt-hours (Wh).
+ * @var toc_hrs Time to charge in hundredths of hours (hours * 100).
+ * @var energy_use Energy consumption at cruise in Wh per mile.
+ * @var passengers Number of passengers the aircraft can carry.
+ * @var fault_prob Probability of a fault per hour.
+ */
+typedef struct AC_SPEC {
+    const char *name;
+    int speed;
+    int batt_cap;
+    int toc_hrs;
+    int energy_use;
+    int passengers;
+    double fault_prob;
+} _ac_spec;
+
+/**
+ * @brief Built-in companies, indexed by _ac_type.
+ */
+constexpr _ac_spec company_specs[TOTAL_CATEGORIES] = {
+    { "ALPHA",   120, 320000, 60, 1600, 4, 0.25 },
+    { "BETA",    100, 100000, 20, 1500, 5, 0.10 },
+    { "CHARLIE", 160, 220000, 80, 2200, 3, 0.05 },
+    { "DELTA",   90,  120000, 62, 800,  2, 0.22 },
+    { "ECHO",    30,  150000, 30, 5800, 2, 0.61 }
+};
+
+// Per simulation msec factors of a specification, shared by the compile time and runtime paths
+constexpr double spec_energy_per_ms(const _ac_spec &s) { return (double)s.energy_use * s.speed / SIMULATION_FACTOR; }
+constexpr double spec_cap_per_soc(const _ac_spec &s) { return s.batt_cap / 100.0; }
+constexpr double spec_miles_per_ms(const _ac_spec &s) { return s.speed / SIMULATION_FACTOR; }
+
+constexpr bool same_spec(const _ac_spec &a, const _ac_spec &b) {
+    return (a.speed == b.speed) && (a.batt_cap == b.batt_cap) && (a.toc_hrs == b.toc_hrs) &&
+           (a.energy_use == b.energy_use) && (a.passengers == b.passengers);
+}
+
+/**
+ * @brief Compile time factors of a built-in company. Used to instantiate the flight kernel
+ *        per company, so its per tick math runs on folded constants.
+ */
+template<int C>
+struct company_traits {
+    static_assert((C >= 0) && (C < TOTAL_CATEGORIES), "unknown company");
+    static constexpr double energy_per_ms = spec_energy_per_ms(company_specs[C]);
+    static constexpr double cap_per_soc = spec_cap_per_soc(company_specs[C]);
+    static constexpr double miles_per_ms = spec_miles_per_ms(company_specs[C]);
+};
+
+/**
+ * @brief Contiguous aircraft of one company in the fleet store.
+ *
+ * @var begin First aircraft.
+ * @var end One past the last aircraft.
+ * @var company Company (_ac_type).
+ * @var builtin True if the company runs with its built-in specification, the flight kernel
+ *              then uses the compile time factors instead of the per aircraft arrays.
+ */
+typedef struct FLEET_RUN {
+    int begin;
+    int end;
+    int company;
+    bool builtin;
+} _fleet_run;
+
+/**
+ * @brief Struct-of-arrays store for the fleet state touched on every tick. Each array is
+ *        indexed by aircraft number and contiguous, so the in-flight integration is one
+ *        streaming pass over the fleet. Per company factors are resolved into dense per
+ *        aircraft arrays when the aircraft is created, no map lookups on the hot path.
+ *
+ * @var flight_time Flight time in hours.
+ * @var miles_travelled Miles travelled.
+ * @var bat_cap_used Used battery capacity in Wh.
+ * @var battery_soc Battery state of charge, 100 to 0.
+ * @var status Current status of aircraft (_ac_stat).
+ * @var company Aircraft company (_ac_type).
+ * @var energy_per_ms Energy used per simulation msec in flight.
+ * @var cap_per_soc Battery capacity per % soc (whole Wh).
+ * @var miles_per_ms Miles travelled per simulation msec in flight.
+ * @var bat_cap_limit Used battery capacity (Wh) at the soc threshold, flight segments end here.
+ * @var spec Specification each company runs with, built-in or loaded at runtime. The fault
+ *      probability is set by fault_injection().
+ * @var runs Contiguous runs of aircraft of one company, set by create_aircrafts().
+ */
+typedef struct FLEET_STORE {
+    vector<double> flight_time;
+    vector<double> miles_travelled;
+    vector<double> bat_cap_used;
+    vector<double> battery_soc;
+    vector<int8_t> status;
+    vector<uint8_t> company;
+    vector<double> energy_per_ms;
+    vector<double> cap_per_soc;
+    vector<double> miles_per_ms;
+    vector<double> bat_cap_limit;
+    _ac_spec spec[TOTAL_CATEGORIES];
+    vector<_fleet_run> runs;
+} _fleet_store;
+
+void init_fleet_store(_fleet_store *fs, int size);
+void fleet_integrate_flight(_fleet_store *fs, int begin, int end, milliseconds t);
 
 /**
  * @class aircraft
  * @brief Represents an aircraft with status, flight, battery, and charging management.
- *        Stores static aircraft info and dynamic state such as flight time, battery state,
- *        charging status, and fault tracking. Supports state machine logic for flight,
- *        charging, and maintenance states.
+ *        Stores static aircraft info and the state that changes on transitions only
+ *        (faults, charging, maintenance). Flight time, miles, battery and status live in
+ *        the fleet store and are advanced for the whole fleet by fleet_integrate_flight(),
+ *        in closed form up to the end of the flight segment at the soc threshold.
+ *        Supports state machine logic for flight, charging, and maintenance states.
  */
 class aircraft {
     private:
         pid_t tid;
         _ac_info ac;
-        double flight_time;                    // in hours
-        double miles_travelled;                // in mile        
-        _ac_stat status;                       // current status of aircraft
+        _fleet_store *fleet;                   // flight time, miles, battery and status
         _ac_stat prev_status;                  // state before going to maintainence
         int fault_count;                       // total faults encountered
-        double battery_soc;                    // 100 to 0
-        double bat_cap_used;                   // Usede battery capacity 
         _charger_id c_id;                      // charger id on which aircarft is currently charging
         double charge_time;                    // in hours
         int charge_time_offset;                // offset to subtract from charge time
+        int charge_full;                       // msec for a full charge at the charger power
         int charge_sessions;                   // number of charge sesssions that the aircraft went for
         int downtime;
-        map<_ac_type, vector<double>> *calc_factors;
+        double downtime_limit;                 // maintenance time per fault in msec
+        int soc_threshold;                     // battery soc at which the aircraft goes to charge
+        double booked_flight_time;             // flight time, miles and charge time already
+        double booked_miles;                   // added to the live statistics
+        double booked_charge_time;
+
+        /**
+         * @brief Adds the flight since the last booking to the live statistics as one segment.
+         */
+        void book_segment(_fleet_live_stats *ls) {
+            double ft = fleet->flight_time[ac.ac_num];
+            double mi = fleet->miles_travelled[ac.ac_num];
+            ls->add_segment(ac.company, ft - booked_flight_time, mi - booked_miles);
+            booked_flight_time = ft;
+            booked_miles = mi;
+        }
+
+        /**
+         * @brief Adds the charge time since the last booking to the live statistics.
+         */
+        void book_charge(_fleet_live_stats *ls) {
+            ls->add(ac.company, LIVE_CHARGE_TIME, charge_time - booked_charge_time);
+            booked_charge_time = charge_time;
+        }
     public:
         // Constructors
-        aircraft(int num, _ac_type com, _ac_map *m, map<_ac_type, vector<double>> *c) {
-            if((com<=4) && (com>=0) && m) {
-                vector<int> para = m->at(com);
+        aircraft(int num, _ac_type com, _fleet_store *fs) {
+            if((com<=4) && (com>=0) && fs) {
+                const _ac_spec &spec = fs->spec[com];
                 ac.ac_num = num;
                 ac.company = com;          
                 // fill parameters
-                ac.speed = para[0];
-                ac.batt_cap = para[1];
-                ac.toc_hrs = para[2];
-                ac.energy_use = para[3];
-                ac.passengers = para[4];
+                ac.speed = spec.speed;
+                ac.batt_cap = spec.batt_cap;
+                ac.toc_hrs = spec.toc_hrs;
+                ac.energy_use = spec.energy_use;
+                ac.passengers = spec.passengers;
                 // init status
-                flight_time = 0;
-                miles_travelled = 0;
-                status = STANDBY;
+                fleet = fs;
+                fleet->flight_time[num] = 0;
+                fleet->miles_travelled[num] = 0;
+                fleet->status[num] = STANDBY;
+                fleet->company[num] = com;
+                fleet->battery_soc[num] = 100;
+                fleet->bat_cap_used[num] = 0;
+                // resolve company factors once
+                fleet->energy_per_ms[num] = spec_energy_per_ms(spec);
+                fleet->cap_per_soc[num] = spec_cap_per_soc(spec);
+                fleet->miles_per_ms[num] = spec_miles_per_ms(spec);
+                fleet->bat_cap_limit[num] = (100 - BATTERY_SOC_THREASHOLD) * fleet->cap_per_soc[num];
+                prev_status = STANDBY;
                 fault_count = 0;
-                battery_soc = 100;
-                bat_cap_used = 0;
                 charge_time = 0;
                 charge_time_offset = 0;
+                charge_full = ac.toc_hrs * SIMULATION_FACTOR / 100;
+                charge_sessions = 0;
                 downtime = 0;
+                downtime_limit = DOWNTIME_SIMUL_TIME;
+                soc_threshold = BATTERY_SOC_THREASHOLD;
+                booked_flight_time = 0;
+                booked_miles = 0;
+                booked_charge_time = 0;
                 c_id = NO_CHARGER;
-                calc_factors = c;
             }
         }
-        // Destructors
-        ~aircraft() {}
+        // Destructors, trivial so the arena has nothing to run on reset
+        ~aircraft() = default;
 
         // Setter functions
         void set_status(_ac_stat s) {
-            status = s;
+            fleet->status[ac.ac_num] = s;
+        }
+        void set_limits(double downtime_ms, int soc, double power) {
+            downtime_limit = downtime_ms;
+            soc_threshold = soc;
+            charge_full = (int)(ac.toc_hrs * SIMULATION_FACTOR / 100 / power);
+            fleet->bat_cap_limit[ac.ac_num] = (100 - soc) * fleet->cap_per_soc[ac.ac_num];
+        }
+        /**
+         * @brief Sets the next flight leg of the network model. The flight segment ends
+         *        once the leg energy is used, on landing, and the charge after it takes charge_ms.
+         *
+         * @param energy Energy of the leg in Wh, at most the battery down to the soc threshold.
+         * @param charge_ms Charge time after the leg in simulation msec.
+         */
+        void set_leg(double energy, int charge_ms) {
+            fleet->bat_cap_limit[ac.ac_num] = energy;
+            charge_full = charge_ms;
         }
         void update_ac_stats(milliseconds t) {
-            if(status==IN_FLIGHT) {
-                flight_time += (t.count() * REAL_TO_REEL_TIME_FACTOR);
-                miles_travelled += t.count() * (calc_factors->at(ac.company)[2]);
-                bat_cap_used += (t.count() * (calc_factors->at(ac.company)[0]));
-                battery_soc = (100 - ((int)bat_cap_used / (int)(calc_factors->at(ac.company)[1])));
-            }
+            fleet_integrate_flight(fleet, ac.ac_num, ac.ac_num + 1, t);
         }
 
         // Getter functions
@@ -184,7 +479,7 @@ class aircraft {
             return (this->ac).ac_num;
         }
         int get_ac_status() {
-            return status;
+            return fleet->status[ac.ac_num];
         }
         _ac_type get_company() {
             return (this->ac).company;
@@ -195,83 +490,176 @@ class aircraft {
         _ac_info *get_ac_info() {
             return (&ac);
         }
-        double get_flight_time() { return flight_time; }
+        double get_flight_time() { return fleet->flight_time[ac.ac_num]; }
         double get_charge_time() { return charge_time; }
-        double get_miles() { return miles_travelled; }
+        double get_miles() { return fleet->miles_travelled[ac.ac_num]; }
         double get_fault_count() { return fault_count; }
-        double get_battery_soc() { return battery_soc; }
+        double get_battery_soc() { return fleet->battery_soc[ac.ac_num]; }
         int get_charger_id() { return c_id; }
         int get_charger_sessions() { return charge_sessions; }
+        int get_downtime() { return downtime; }
+        double get_downtime_limit() { return downtime_limit; }
+
+        /**
+         * @brief Flight time left before the battery drops to the soc threshold.
+         *        Used by the event engine to schedule the battery-depleted event.
+         *
+         * @return Time to threshold in simulation milliseconds, rounded up (minimum 1 ms).
+         *         Advancing by it always ends the flight segment exactly at the threshold.
+         */
+        milliseconds time_to_soc_threshold() {
+            double left = (fleet->bat_cap_limit[ac.ac_num] - fleet->bat_cap_used[ac.ac_num]) / fleet->energy_per_ms[ac.ac_num];
+            return milliseconds((left > 1) ? (long)ceil(left) : 1);
+        }
+
+        /**
+         * @brief Books the open flight segment and charge session, so the live statistics
+         *        cover the whole run. Call once the run has ended.
+         */
+        void book_open(_fleet_live_stats *ls) {
+            if(fleet->flight_time[ac.ac_num] > booked_flight_time) {
+                book_segment(ls);
+            }
+            if(charge_time > booked_charge_time) {
+                book_charge(ls);
+            }
+        }
+
+        /**
+         * @brief Writes the transition state of the aircraft to a checkpoint. Flight state
+         *        lives in the fleet store and is saved with it.
+         */
+        void save(ckpt_writer *w) {
+            w->put(prev_status);
+            w->put(fault_count);
+            w->put(c_id);
+            w->put(charge_time);
+            w->put(charge_time_offset);
+            w->put(charge_full);
+            w->put(charge_sessions);
+            w->put(downtime);
+            w->put(downtime_limit);
+            w->put(soc_threshold);
+            w->put(booked_flight_time);
+            w->put(booked_miles);
+            w->put(booked_charge_time);
+        }
+
+        /**
+         * @brief Restores the transition state written by save().
+         *
+         * @return False if the checkpoint is damaged.
+         */
+        bool load(ckpt_reader *r) {
+            r->get(&prev_status);
+            r->get(&fault_count);
+            r->get(&c_id);
+            r->get(&charge_time);
+            r->get(&charge_time_offset);
+            r->get(&charge_full);
+            r->get(&charge_sessions);
+            r->get(&downtime);
+            r->get(&downtime_limit);
+            r->get(&soc_threshold);
+            r->get(&booked_flight_time);
+            r->get(&booked_miles);
+            return r->get(&booked_charge_time);
+        }
 
-        // State machine for aircraft simulation
-        void state_machine(milliseconds t, int charge_sig, int *fault_sig, queue<_c_queue_entry*> *cq) {
+        /**
+         * @brief State machine for aircraft simulation. In flight stats must already be
+         *        advanced by t through fleet_integrate_flight(), the state machine only
+         *        handles transitions and the charging/maintenance timers. Completed flight
+         *        segments, ended charge sessions and faults are booked in the live statistics.
+         */
+        void state_machine(milliseconds t, _ac_mailbox *mb, mpsc_queue<_c_queue_entry> *cq, _fleet_live_stats *ls) {
+            int8_t &status = fleet->status[ac.ac_num];
+            int faults = (status == STANDBY) ? 0 : mb->faults.exchange(0, memory_order_acquire);
+            int charge_sig = mb->charge.load(memory_order_acquire);
             switch(status) {
                 case IN_FLIGHT:
-                    if(*fault_sig==1) {
-                        fault_count++;
-                        *fault_sig = 0;
+                    if(faults) {
+                        fault_count += faults;
+                        ls->add(ac.company, LIVE_FAULTS, faults);
+                        book_segment(ls);
+                        prev_status = (_ac_stat)status;
                         status = UNDER_MAINTENANCE;
                     } else {
-                        update_ac_stats(t);
-                        // check battery
-                        if(battery_soc <= BATTERY_SOC_THREASHOLD) {
-                            _c_queue_entry *n = new _c_queue_entry;
-                            n->ac_num = ac.ac_num;
-                            n->charge_time = ac.toc_hrs*SIMULATION_FACTOR/100;
-                            cq->push(n);
-                            status = IN_CHARGE_QUEUE;
+                        // check battery, the flight segment ends exactly at the limit
+                        if(fleet->bat_cap_used[ac.ac_num] >= fleet->bat_cap_limit[ac.ac_num]) {
+                            _c_queue_entry n = {ac.ac_num, charge_full, ac.passengers, CHARGE_REQUEST, NO_CHARGER};
+                            if(cq->push(n)) {                   // queue full, retry on next step
+                                book_segment(ls);
+                                status = IN_CHARGE_QUEUE;
+                            }
                         }
                     }
                     break;
                 case IN_CHARGE_QUEUE:
-                    if(*fault_sig==1) {
-                        fault_count++;
-                        *fault_sig = 0;
-                        status = UNDER_MAINTENANCE;
+                    if(faults) {
+                        _c_queue_entry r = {ac.ac_num, 0, ac.passengers, CHARGE_CANCEL, NO_CHARGER};
+                        if(cq->push(r)) {                   // drops the request and a charger it may already have
+                            fault_count += faults;
+                            ls->add(ac.company, LIVE_FAULTS, faults);
+                            prev_status = (_ac_stat)status;
+                            status = UNDER_MAINTENANCE;
+                        } else {                            // queue full, take the faults on next step
+                            mb->faults.fetch_add(faults, memory_order_relaxed);
+                        }
                     } else {
                         if(charge_sig > 0) {
                             c_id = (_charger_id)(charge_sig);
                             status = CHARGING;
                             charge_sessions++;
+                            ls->add(ac.company, LIVE_CHARGE_SESSIONS, 1);
                         }
                     }
                     break;
                 case CHARGING:
-                    if(*fault_sig==1) {
-                        fault_count++;
+                    if(faults) {
+                        fault_count += faults;
+                        ls->add(ac.company, LIVE_FAULTS, faults);
+                        book_charge(ls);
+                        _c_queue_entry r = {ac.ac_num, 0, ac.passengers, CHARGER_RELEASE, c_id};
+                        cq->push(r);                        // queue full, the charger frees itself when the session ends
                         c_id = NO_CHARGER;
-                        *fault_sig = 2;                                 // setting to 2 to notify charging service
+                        prev_status = (_ac_stat)status;
                         status = UNDER_MAINTENANCE;
                     } else {
-                        charge_time += (t.count() * REAL_TO_REEL_TIME_FACTOR);
+                        charge_time += (t.count() * SIM_MS_TO_HOURS);
                         charge_time_offset += t.count();            // keep a record for charge time 
                         if(charge_sig == 0) {
+                            book_charge(ls);
                             charge_time_offset = 0;          // reset the offset to 0
-                            bat_cap_used = 0;
-                            battery_soc = 100;
+                            fleet->bat_cap_used[ac.ac_num] = 0;
+                            fleet->battery_soc[ac.ac_num] = 100;
                             c_id = NO_CHARGER;
                             status = IN_FLIGHT;
                         }
                     }
                     break;
                 case UNDER_MAINTENANCE:
-                    if(*fault_sig==1) {                     // restart servicing again
-                        fault_count++;
+                    if(faults) {                            // restart servicing again
+                        fault_count += faults;
+                        ls->add(ac.company, LIVE_FAULTS, faults);
                         downtime = 0;
-                        *fault_sig = 0;  
                     }
                     downtime += t.count();
-                    if(downtime >= DOWNTIME_SIMUL_TIME) {
-                        downtime = 0;
+                    if(downtime >= downtime_limit) {
                         if(prev_status == CHARGING || prev_status == IN_CHARGE_QUEUE) {
-                            _c_queue_entry *n = new _c_queue_entry;
-                            n->ac_num = ac.ac_num;
-                            n->charge_time = (ac.toc_hrs*SIMULATION_FACTOR/100) - charge_time_offset;
-                            cq->push(n);
-                            charge_time_offset = 0;
-                            status = IN_CHARGE_QUEUE;
-                            if(prev_status == CHARGING) { charge_sessions--; }       // prev charge session was not complete. Removing it.
+                            _c_queue_entry n = {ac.ac_num, charge_full - charge_time_offset,
+                                                ac.passengers, CHARGE_REQUEST, NO_CHARGER};
+                            if(cq->push(n)) {                   // queue full, stay in maintenance and retry on next step
+                                downtime = 0;
+                                charge_time_offset = 0;
+                                status = IN_CHARGE_QUEUE;
+                                if(prev_status == CHARGING) {                            // prev charge session was not complete. Removing it.
+                                    charge_sessions--;
+                                    ls->add(ac.company, LIVE_CHARGE_SESSIONS, -1);
+                                }
+                            }
                         } else {
+                            downtime = 0;
                             status = prev_status;
                         }
                     }
@@ -287,74 +675,357 @@ class aircraft {
 
 /**
  * @class charger
- * @brief Manages the state, usage, and history of three chargers.
- *        Tracks the status, usage time, and assigned aircraft for each charger.
+ * @brief Pool of N chargers, N set at runtime. Tracks the status, usage time and assigned
+ *        aircraft for each charger. Free chargers are kept in a min-heap of ids and running
+ *        sessions in a min-heap of finish times, so assigning, releasing and finding the
+ *        next finished session are O(log n) in the number of chargers. Waiting aircraft
+ *        are kept in a heap ordered by the dispatch policy. The heaps are plain vectors,
+ *        so a checkpoint stores them exactly as they are.
+ *        The pool keeps its own clock, advanced by the charging service.
  */
 class charger {
     private:
-        _charger_info charger1;
-        _charger_info charger2;
-        _charger_info charger3;
+        vector<_charger_info> info;            // indexed by charger id, 0 unused
+        vector<_c_live_info> live;             // indexed by charger id, 0 unused
+        vector<long> start_at;                 // pool time the current session started
+        vector<long> finish_at;                // pool time the current session ends
+        vector<unsigned long> session;         // bumped on every assignment, invalidates busy heap entries
+        vector<_charger_id> free_ids;          // min-heap, greater<_charger_id>
+        vector<_c_session> busy;               // min-heap, _c_session_later
+        vector<_c_wait_entry> waiting;         // min-heap, _c_wait_later
+        _dispatch_policy policy;
+        unsigned long arrivals;                // arrival counter for the waiting queue
+        long clock;                            // pool time in msec
+        int active;                            // chargers 1..active take new sessions
     public:
-        charger() {
-            charger1.status = READY_TO_CHARGE;
-            charger2.status = READY_TO_CHARGE;
-            charger3.status = READY_TO_CHARGE;
-        }
+        charger() : policy(DISPATCH_FIFO), arrivals(0), clock(0), active(0) {}
         ~charger() = default;
 
-        _charger_stat check_charger(_charger_id id) {
-            _charger_stat stat=BUSY_CHARGING;
-            if(id==CHARGER_1) {
-                stat = charger1.status;
-            } else if(id==CHARGER_2) {
-                stat = charger2.status;
-            } else if(id==CHARGER_3) {
-                stat = charger3.status;
+        /**
+         * @brief Resets the pool to n free chargers.
+         *
+         * @param n Number of chargers (at least 1).
+         * @param p Dispatch policy for waiting aircraft.
+         */
+        void init(int n, _dispatch_policy p) {
+            if(n < 1) {
+                n = 1;
+            }
+            info.assign(n + 1, _charger_info());
+            live.assign(n + 1, {READY_TO_CHARGE, -1, 0});
+            start_at.assign(n + 1, 0);
+            finish_at.assign(n + 1, 0);
+            session.assign(n + 1, 0);
+            free_ids.clear();
+            busy.clear();
+            waiting.clear();
+            for(_charger_id id=1; id<=n; id++) {
+                info[id].status = READY_TO_CHARGE;
+                info[id].use_time = 0;
+                free_ids.push_back(id);
+                push_heap(free_ids.begin(), free_ids.end(), greater<_charger_id>());
+            }
+            policy = p;
+            arrivals = 0;
+            clock = 0;
+            active = n;
+        }
+
+        /**
+         * @brief Changes the number of chargers taking new sessions, e.g. for a what-if branch
+         *        of a restored run. New chargers start free. Removed chargers finish their
+         *        running session, then go out of service; their usage stays booked.
+         *
+         * @param n Number of chargers (at least 1).
+         */
+        void resize(int n) {
+            if(n < 1) {
+                n = 1;
+            }
+            if(n > size()) {
+                info.resize(n + 1);
+                live.resize(n + 1, {READY_TO_CHARGE, -1, 0});
+                start_at.resize(n + 1, 0);
+                finish_at.resize(n + 1, 0);
+                session.resize(n + 1, 0);
+            }
+            free_ids.clear();
+            for(_charger_id id=1; id<=size(); id++) {
+                if(live[id].status != BUSY_CHARGING) {
+                    info[id].status = (id <= n) ? READY_TO_CHARGE : OUT_OF_SERVICE;
+                    if(id <= n) {
+                        free_ids.push_back(id);
+                    }
+                }
+            }
+            make_heap(free_ids.begin(), free_ids.end(), greater<_charger_id>());
+            active = n;
+        }
+
+        int size() { return (int)info.size() - 1; }
+        size_t waiting_count() { return waiting.size(); }
+
+        void advance(milliseconds elapsed) {
+            clock += elapsed.count();
+        }
+
+        /**
+         * @brief Adds a charge request to the waiting aircraft.
+         */
+        void enqueue(const _c_queue_entry &e) {
+            long key = 0;
+            if(policy == DISPATCH_SHORTEST_CHARGE) {
+                key = e.charge_time;
+            } else if(policy == DISPATCH_PASSENGERS) {
+                key = -e.passengers;
+            }
+            waiting.push_back({key, arrivals++, e});
+            push_heap(waiting.begin(), waiting.end(), _c_wait_later());
+        }
+
+        /**
+         * @brief Takes the next session that ended at or before the pool clock.
+         *
+         * @param id Filled with the charger id.
+         *
+         * @return False if no session has ended.
+         */
+        bool pop_finished(_charger_id *id) {
+            while(!busy.empty()) {
+                _c_session s = busy.front();
+                bool stale = (s.session != session[s.id]) || (live[s.id].status != BUSY_CHARGING);
+                if(!stale && (s.finish_at > clock)) {
+                    break;
+                }
+                pop_heap(busy.begin(), busy.end(), _c_session_later());
+                busy.pop_back();
+                if(!stale) {
+                    *id = s.id;
+                    return true;
+                }                                       // released early, stale entry
+            }
+            return false;
+        }
+
+        /**
+         * @brief Frees a busy charger and books its usage time.
+         *
+         * @return Aircraft that was on the charger, -1 if it was not busy.
+         */
+        int release(_charger_id id) {
+            if((id < 1) || (id > size()) || (live[id].status != BUSY_CHARGING)) {
+                return -1;
+            }
+            int ac_num = live[id].ac_num;
+            info[id].use_time += (int)(min(clock, finish_at[id]) - start_at[id]);
+            live[id] = {READY_TO_CHARGE, -1, 0};
+            if(id <= active) {
+                info[id].status = READY_TO_CHARGE;
+                free_ids.push_back(id);
+                push_heap(free_ids.begin(), free_ids.end(), greater<_charger_id>());
+            } else {
+                info[id].status = OUT_OF_SERVICE;       // removed by resize()
+            }
+            return ac_num;
+        }
+
+        /**
+         * @brief Drops the request of an aircraft that faulted while queued: frees its charger
+         *        if it was already assigned one, removes it from the waiting requests otherwise.
+         *
+         * @param ac_num Aircraft number.
+         * @param assigned Charger the aircraft was signalled, 0 if none.
+         *
+         * @return Number of requests and sessions dropped.
+         */
+        int cancel(int ac_num, _charger_id assigned) {
+            if((assigned > 0) && (assigned <= size()) && (live[assigned].status == BUSY_CHARGING) &&
+               (live[assigned].ac_num == ac_num)) {
+                release(assigned);                      // its request already left the waiting heap
+                return 1;
+            }
+            size_t before = waiting.size();
+            waiting.erase(remove_if(waiting.begin(), waiting.end(), [ac_num](const _c_wait_entry &w) {
+                return w.entry.ac_num == ac_num;
+            }), waiting.end());
+            int dropped = (int)(before - waiting.size());
+            if(dropped > 0) {
+                make_heap(waiting.begin(), waiting.end(), _c_wait_later());
             }
-            return stat;
-        }   
-
-        void assign_charger(_charger_id id, int ac_num) {
-            if(id==CHARGER_1) {
-                charger1.history.push_back(ac_num);
-            } else if(id==CHARGER_2) {
-                charger2.history.push_back(ac_num);
-            } else if(id==CHARGER_3) {
-                charger3.history.push_back(ac_num);
+            return dropped;
+        }
+
+        /**
+         * @brief Assigns the first waiting aircraft, by dispatch policy, to the lowest free charger.
+         *
+         * @param id Filled with the charger id.
+         * @param e Filled with the charge request.
+         *
+         * @return False if no charger is free or no aircraft is waiting.
+         */
+        bool assign_next(_charger_id *id, _c_queue_entry *e) {
+            if(free_ids.empty() || waiting.empty()) {
+                return false;
+            }
+            *id = free_ids.front();
+            pop_heap(free_ids.begin(), free_ids.end(), greater<_charger_id>());
+            free_ids.pop_back();
+            *e = waiting.front().entry;
+            pop_heap(waiting.begin(), waiting.end(), _c_wait_later());
+            waiting.pop_back();
+            info[*id].status = BUSY_CHARGING;
+            info[*id].history.push_back(e->ac_num);
+            live[*id] = {BUSY_CHARGING, e->ac_num, e->charge_time};
+            start_at[*id] = clock;
+            finish_at[*id] = clock + max(0, e->charge_time);
+            session[*id]++;
+            busy.push_back({finish_at[*id], *id, session[*id]});
+            push_heap(busy.begin(), busy.end(), _c_session_later());
+            return true;
+        }
+
+        /**
+         * @brief Live status of a charger, time left is taken against the pool clock.
+         */
+        _c_live_info get_live(_charger_id id) {
+            _c_live_info ret = {OUT_OF_SERVICE, -1, 0};
+            if((id >= 1) && (id <= size())) {
+                ret = live[id];
+                if(ret.status == BUSY_CHARGING) {
+                    ret.c_time_left = (int)max(0L, finish_at[id] - clock);
+                }
             }
+            return ret;
         }
 
-        void update_usetime(_charger_id id, milliseconds time) {
-           if(id==CHARGER_1) {
-                charger1.use_time += time.count();
-            } else if(id==CHARGER_2) {
-                charger2.use_time += time.count();
-            } else if(id==CHARGER_3) {
-                charger3.use_time += time.count();
-            } 
+        _charger_stat check_charger(_charger_id id) {
+            return ((id >= 1) && (id <= size())) ? info[id].status : OUT_OF_SERVICE;
         }
 
-        void update_charger_stat(_charger_id id, _charger_stat stat) {
-           if(id==CHARGER_1) {
-                charger1.status = stat;
-            } else if(id==CHARGER_2) {
-                charger2.status = stat;
-            } else if(id==CHARGER_3) {
-                charger3.status = stat;
-            } 
+        int get_use_time(_charger_id id) {
+            return ((id >= 1) && (id <= size())) ? info[id].use_time : 0;
         }
 
+        /**
+         * @brief Writes the whole pool, heaps included, to a checkpoint.
+         */
+        void save(ckpt_writer *w) {
+            w->put<int32_t>(size());
+            for(auto &c: info) {
+                w->put(c.status);
+                w->put(c.use_time);
+                w->put_vector(c.history);
+            }
+            w->put_vector(live);
+            w->put_vector(start_at);
+            w->put_vector(finish_at);
+            w->put_vector(session);
+            w->put_vector(free_ids);
+            w->put_records(busy);
+            w->put_records(waiting);
+            w->put(policy);
+            w->put(arrivals);
+            w->put(clock);
+            w->put(active);
+        }
+
+        /**
+         * @brief Restores the pool from a checkpoint written by save().
+         *
+         * @return False if the checkpoint is damaged.
+         */
+        bool load(ckpt_reader *r) {
+            int32_t n = 0;
+            bool ok = r->get(&n) && (n >= 1) && ((size_t)n <= r->remaining());
+            if(ok) {
+                info.assign(n + 1, _charger_info());
+                for(auto &c: info) {
+                    r->get(&c.status);
+                    r->get(&c.use_time);
+                    r->get_vector(&c.history);
+                }
+                r->get_vector(&live);
+                r->get_vector(&start_at);
+                r->get_vector(&finish_at);
+                r->get_vector(&session);
+                r->get_vector(&free_ids);
+                r->get_records(&busy);
+                r->get_records(&waiting);
+                r->get(&policy);
+                r->get(&arrivals);
+                r->get(&clock);
+                r->get(&active);
+                size_t all = (size_t)n + 1;
+                ok = r->good() && (live.size() == all) && (start_at.size() == all) && (finish_at.size() == all) &&
+                     (session.size() == all) && (active >= 1) && (active <= n);
+                for(size_t k=0; ok && (k<free_ids.size()); k++) {
+                    ok = (free_ids[k] >= 1) && (free_ids[k] <= n);
+                }
+                for(size_t k=0; ok && (k<busy.size()); k++) {
+                    ok = (busy[k].id >= 1) && (busy[k].id <= n);
+                }
+            }
+            return ok;
+        }
 };
 
-void create_aircrafts(aircraft **ac_array, int size, _ac_map *map, int categories);
-void delete_aircrafts(aircraft **ac_array, int size);
-void fault_injection(_prob_map *pmap, aircraft **ac_array, int size, _fault_map *q);
-void fault_service(_fault_map *q);
-void data_recorder_service(aircraft **ac_array, int size, ofstream &outfile);
-ofstream open_log_file(const string &filename);
-void close_file(ofstream &outfile);
-bool write_to_file(ofstream &outfile, const string &line);
-void sim_analysis(aircraft **ac_array, int size, int categories, ofstream &outfile);
+/**
+ * @brief Runtime configuration of a simulation run.
+ *
+ * @var aircrafts Number of aircraft in the fleet.
+ * @var sim_hours Simulated time in hours.
+ * @var realtime True to pace the run against the wall clock.
+ * @var time_scale Simulated seconds per wall second with realtime, TIME_SCALE_MAX for as fast as possible.
+ * @var workers Worker threads stepping the fleet in the wall-clock paced run.
+ * @var chargers Number of chargers in the pool.
+ * @var charger_power Charge rate relative to the company charge times, 2 charges twice as fast.
+ * @var policy Dispatch policy for aircraft waiting for a charger.
+ * @var fdr_format Flight data recorder output format.
+ * @var seed Master seed, all random streams of the run are derived from it.
+ * @var log_inputs Print the fleet mix and write the input log, off for batch replications.
+ * @var dump_faults Debug, list the whole fault schedule in the input log and on the console.
+ * @var live_interval Wall seconds between live statistics reports, 0 for none.
+ * @var replications Batch mode replications, 0 for a single run.
+ * @var mix Aircraft per company, all 0 for a random mix of cfg.aircrafts.
+ * @var fault_scale Multiplier on the per company fault probabilities.
+ * @var downtime_hours Maintenance time per fault in hours.
+ * @var soc_threshold Battery soc (%) at which an aircraft goes to charge.
+ * @var fdr_interval Flight data recorder interval in simulation msec.
+ * @var manifest Company of every aircraft, nullptr to draw the fleet from mix or at random.
+ * @var checkpoint_hours Simulated hours between checkpoints of the event engine, 0 for none.
+ * @var checkpoint_file Checkpoint file, replaced by every new checkpoint.
+ * @var sites Vertiports of the network model, each with cfg.chargers chargers. 0 for the single charger bank.
+ * @var site_miles Spacing of the vertiport grid in miles.
+ */
+typedef struct SIM_CONFIG {
+    int aircrafts;
+    double sim_hours;
+    bool realtime;
+    double time_scale;
+    int workers;
+    int chargers;
+    double charger_power;
+    _dispatch_policy policy;
+    _fdr_format fdr_format;
+    uint64_t seed;
+    bool log_inputs;
+    bool dump_faults;
+    double live_interval;
+    int replications;
+    int mix[TOTAL_CATEGORIES];
+    double fault_scale;
+    double downtime_hours;
+    int soc_threshold;
+    int fdr_interval;
+    const vector<uint8_t> *manifest;
+    double checkpoint_hours;
+    const char *checkpoint_file;
+    int sites;
+    double site_miles;
+} _sim_config;
+
+void default_sim_config(_sim_config *cfg);
+extern _ac_map paramter_map;
+extern _prob_map probablity_map;
 
 #endif //_DEFINITIONS_
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef _EVENT_ENGINE_
+#define _EVENT_ENGINE_
+
+#include "../includes/sim_context.hpp"
+#include "../includes/ac_simul.hpp"
+#include "../includes/checkpoint.hpp"
+
+// Discrete events handled by the event engine
+typedef enum EVENT_TYPE {
+    EV_FAULT=0,
+    EV_BATTERY_DEPLETED=1,
+    EV_CHARGE_COMPLETE=2,
+    EV_MAINTENANCE_DONE=3,
+    EV_FDR_SAMPLE=4,
+    EV_SIM_END=5
+} _event_type;
+
+/**
+ * @brief Timestamped simulation event.
+ *
+ * @var time Simulation time at which the event fires.
+ * @var seq Insertion sequence number, keeps coincident events in FIFO order.
+ * @var type Event type.
+ * @var ac_num Aircraft the event belongs to (-1 for global events).
+ * @var epoch Aircraft epoch at scheduling time. Events from an older epoch are stale.
+ */
+typedef struct SIM_EVENT {
+    milliseconds time;
+    unsigned long seq;
+    _event_type type;
+    int ac_num;
+    int epoch;
+} _sim_event;
+
+// Checkpoint an event field by field, its tail padding is never written
+static inline void put_record(ckpt_writer *w, const _sim_event &e) {
+    w->put(e.time);
+    w->put(e.seq);
+    w->put(e.type);
+    w->put(e.ac_num);
+    w->put(e.epoch);
+}
+static inline bool get_record(ckpt_reader *r, _sim_event *e) {
+    r->get(&e->time);
+    r->get(&e->seq);
+    r->get(&e->type);
+    r->get(&e->ac_num);
+    return r->get(&e->epoch);
+}
+
+/**
+ * @brief Ordering for the event queue. Earliest event first, ties broken by insertion order.
+ */
+struct _event_later {
+    bool operator()(const _sim_event &a, const _sim_event &b) const {
+        return (a.time == b.time) ? (a.seq > b.seq) : (a.time > b.time);
+    }
+};
+
+void des_simulation(_sim_context *ctx, milliseconds end_time);
+bool des_resume(_sim_context *ctx, ckpt_reader *r, milliseconds now, milliseconds end_time, const _sim_config *what_if);
+
+#endif //_EVENT_ENGINE_
@@ -0,0 +1,236 @@
+#ifndef _FAULT_SCHEDULE_
+#define _FAULT_SCHEDULE_
+
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstddef>
+#include "../includes/philox.hpp"
+#include "../includes/ckpt_stream.hpp"
+
+using namespace std;
+using namespace std::chrono;
+
+/**
+ * @brief One scheduled fault.
+ *
+ * @var time Simulation time of the fault.
+ * @var ac_num Aircraft the fault is injected into.
+ */
+typedef struct FAULT_EVENT {
+    milliseconds time;
+    int ac_num;
+} _fault_event;
+
+// Checkpoint a fault field by field, its tail padding is never written
+static inline void put_record(ckpt_writer *w, const _fault_event &f) {
+    w->put(f.time);
+    w->put(f.ac_num);
+}
+static inline bool get_record(ckpt_reader *r, _fault_event *f) {
+    r->get(&f->time);
+    return r->get(&f->ac_num);
+}
+
+/**
+ * @brief Ordering for the fault heap. Earliest fault first, coincident faults by aircraft number.
+ */
+struct _fault_later {
+    bool operator()(const _fault_event &a, const _fault_event &b) const {
+        return (a.time == b.time) ? (a.ac_num > b.ac_num) : (a.time > b.time);
+    }
+};
+
+/**
+ * @brief Fault process of one aircraft.
+ *
+ * @var rng Random stream of the aircraft.
+ * @var lambda Fault rate per minute.
+ * @var minutes Time of the last sampled fault in minutes, kept exact between draws.
+ */
+typedef struct FAULT_SOURCE {
+    philox_rng rng;
+    double lambda;
+    double minutes;
+} _fault_source;
+
+// Checkpoint a fault process field by field, the padding after rng is never written
+static inline void put_record(ckpt_writer *w, const _fault_source &s) {
+    w->put(s.rng);
+    w->put(s.lambda);
+    w->put(s.minutes);
+}
+static inline bool get_record(ckpt_reader *r, _fault_source *s) {
+    r->get(&s->rng);
+    r->get(&s->lambda);
+    return r->get(&s->minutes);
+}
+
+/**
+ * @class fault_schedule
+ * @brief Faults sampled on demand. Every aircraft holds only its next fault time, the
+ *        following one is drawn from its exponential distribution when that fault fires.
+ *        Pending faults live in a min-heap with at most one entry per aircraft, so memory
+ *        is O(fleet) and setup does not depend on the simulated horizon. Coincident
+ *        faults are all kept, and every fault due at or before a given time is
+ *        dispatched in one pass, O(due log fleet).
+ */
+class fault_schedule {
+    private:
+        vector<_fault_source> sources;         // by aircraft number
+        vector<_fault_event> heap;             // next fault of every aircraft that has one
+        double horizon;                        // minutes, no faults at or after it
+
+        /**
+         * @brief Draws the next fault of an aircraft and queues it if it is within the horizon.
+         */
+        void sample(int ac) {
+            _fault_source *s = &sources[ac];
+            s->minutes += s->rng.exponential(s->lambda);
+            if(s->minutes < horizon) {
+                heap.push_back({milliseconds((long)(s->minutes*1000)), ac});
+                push_heap(heap.begin(), heap.end(), _fault_later());
+            }
+        }
+
+        /**
+         * @brief Removes the earliest fault and draws the next one of its aircraft.
+         */
+        _fault_event pop_next() {
+            _fault_event ev = heap.front();
+            pop_heap(heap.begin(), heap.end(), _fault_later());
+            heap.pop_back();
+            sample(ev.ac_num);
+            return ev;
+        }
+    public:
+        fault_schedule() : horizon(0) {}
+
+        /**
+         * @brief Drops all faults and sets the fleet size and horizon. Storage is kept for reuse.
+         *
+         * @param aircrafts Fleet size.
+         * @param horizon_minutes Simulated time in minutes.
+         */
+        void init(int aircrafts, double horizon_minutes) {
+            sources.resize(aircrafts);
+            heap.clear();
+            heap.reserve(aircrafts);
+            horizon = horizon_minutes;
+        }
+
+        void clear() { init(0, 0); }
+
+        /**
+         * @brief Starts the fault process of an aircraft and draws its first fault.
+         *
+         * @param ac Aircraft number.
+         * @param rng Random stream of the aircraft, positioned at its first draw.
+         * @param lambda Fault rate per minute, no faults if not positive.
+         * @param from Start of the process in minutes, later than 0 for a restored run.
+         */
+        void arm(int ac, const philox_rng &rng, double lambda, double from=0) {
+            _fault_source *s = &sources[ac];
+            s->rng = rng;
+            s->lambda = lambda;
+            s->minutes = from;
+            if(lambda > 0) {
+                sample(ac);
+            }
+        }
+
+        /**
+         * @brief Next fault of one aircraft, for engines that queue the faults of every aircraft
+         *        themselves (the vertiport network). The shared heap is then not used, each
+         *        source is only touched by the partition that owns its aircraft.
+         *
+         * @param ac Aircraft number.
+         * @param t Filled with the time of the fault.
+         *
+         * @return False if the aircraft has no more faults within the horizon.
+         */
+        bool source_next(int ac, milliseconds *t) const {
+            const _fault_source &s = sources[ac];
+            if((s.lambda <= 0) || (s.minutes >= horizon)) {
+                return false;
+            }
+            *t = milliseconds((long)(s.minutes*1000));
+            return true;
+        }
+
+        /**
+         * @brief Draws the fault after the one returned by source_next(), same sequence as the heap.
+         *
+         * @param ac Aircraft number.
+         */
+        void source_draw(int ac) {
+            _fault_source *s = &sources[ac];
+            s->minutes += s->rng.exponential(s->lambda);
+        }
+
+        size_t pending() { return heap.size(); }
+        double get_horizon() { return horizon; }
+        bool empty() { return heap.empty(); }
+        milliseconds next_time() { return heap.front().time; }
+
+        /**
+         * @brief Dispatches every fault due at or before now, drawing the next fault of
+         *        each aircraft as its fault fires.
+         *
+         * @param now Current simulation time.
+         * @param inject Called with the aircraft number of every due fault, in time order.
+         *
+         * @return Number of faults dispatched.
+         */
+        template <typename F>
+        size_t dispatch_due(milliseconds now, F inject) {
+            size_t count = 0;
+            while(!heap.empty() && (heap.front().time <= now)) {
+                inject(pop_next().ac_num);
+                count++;
+            }
+            return count;
+        }
+
+        /**
+         * @brief Writes the schedule to a checkpoint: every random stream at its current
+         *        position and the pending heap as it is, so a restored run draws the same faults.
+         */
+        void save(ckpt_writer *w) {
+            w->put_records(sources);
+            w->put_records(heap);
+            w->put(horizon);
+        }
+
+        /**
+         * @brief Restores the schedule written by save().
+         *
+         * @param aircrafts Fleet size of the restored run.
+         *
+         * @return False if the checkpoint is damaged or for another fleet size.
+         */
+        bool load(ckpt_reader *r, int aircrafts) {
+            r->get_records(&sources);
+            r->get_records(&heap);
+            bool ok = r->get(&horizon) && (sources.size() == (size_t)aircrafts);
+            for(size_t k=0; ok && (k<heap.size()); k++) {
+                ok = (heap[k].ac_num >= 0) && (heap[k].ac_num < aircrafts);
+            }
+            return ok;
+        }
+
+        /**
+         * @brief Materializes the whole remaining schedule without consuming it, for debugging.
+         *
+         * @param out Filled with every remaining fault in time order.
+         */
+        void dump(vector<_fault_event> *out) const {
+            fault_schedule copy = *this;
+            out->clear();
+            while(!copy.heap.empty()) {
+                out->push_back(copy.pop_next());
+            }
+        }
+};
+
+#endif //_FAULT_SCHEDULE_
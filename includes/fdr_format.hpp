@@ -0,0 +1,112 @@
+#ifndef _FDR_FORMAT_
+#define _FDR_FORMAT_
+
+#include <cstdint>
+
+/**
+ * @brief Binary flight data recorder format. Shared by the simulator and the fdr_convert tool.
+ *
+ *        File layout (host byte order):
+ *        _fdr_file_header
+ *        _fdr_column_desc x columns
+ *        char[FDR_NAME_LEN] x companies          company names
+ *        uint8_t x aircrafts                     company of each aircraft
+ *        sample x N                              until end of file
+ *
+ *        A sample is an int64_t timestamp followed by one block per column. Each block holds
+ *        the column value of every aircraft, width bytes each, so every sample has the same
+ *        size and sample k can be read with a single seek. Fixed point columns are stored as
+ *        value * scale. Delta encoded columns store the difference to the previous sample
+ *        (the first sample against 0), slowly changing counters then encode to mostly zeros.
+ */
+#define FDR_MAGIC               "EVTOLFDR"
+#define FDR_MAGIC_LEN           (8)
+#define FDR_VERSION             (1)
+#define FDR_NAME_LEN            (16)
+#define FDR_FIXED_SCALE         (10000)          // 4 decimals, same as the text recorder
+
+// Flight data recorder output format
+typedef enum FDR_FORMAT {
+    FDR_TEXT=0,                 // one space separated text line per sample
+    FDR_BINARY=1,               // binary columnar, raw values
+    FDR_BINARY_DELTA=2          // binary columnar, counters delta encoded
+} _fdr_format;
+
+// Per column value encoding
+typedef enum FDR_ENCODING {
+    FDR_RAW=0,
+    FDR_DELTA=1
+} _fdr_encoding;
+
+// Recorded columns, in file order
+typedef enum FDR_COLUMN {
+    FDR_COL_STATUS=0,
+    FDR_COL_FLIGHT_TIME,
+    FDR_COL_MILES,
+    FDR_COL_BATTERY_SOC,
+    FDR_COL_CHARGER_ID,
+    FDR_COL_CHARGE_TIME,
+    FDR_COL_FAULT_COUNT,
+    FDR_COL_CHARGE_SESSIONS,
+    FDR_TOTAL_COLUMNS
+} _fdr_column;
+
+/**
+ * @brief File header.
+ *
+ * @var magic FDR_MAGIC, not null terminated.
+ * @var version FDR_VERSION.
+ * @var aircrafts Number of aircraft per sample.
+ * @var columns Number of column descriptors.
+ * @var companies Number of company names.
+ * @var interval Sample interval in simulation msec.
+ * @var scale Fixed point scale.
+ */
+typedef struct FDR_FILE_HEADER {
+    char magic[FDR_MAGIC_LEN];
+    uint32_t version;
+    uint32_t aircrafts;
+    uint32_t columns;
+    uint32_t companies;
+    uint32_t interval;
+    uint32_t scale;
+} _fdr_file_header;
+
+/**
+ * @brief Column descriptor.
+ *
+ * @var name Column name, same as the text log header.
+ * @var width Value width in bytes (1, 4 or 8), signed.
+ * @var encoding _fdr_encoding.
+ * @var fixed 1 if the value is fixed point (value * scale).
+ * @var reserved Padding, 0.
+ */
+typedef struct FDR_COLUMN_DESC {
+    char name[FDR_NAME_LEN];
+    uint8_t width;
+    uint8_t encoding;
+    uint8_t fixed;
+    uint8_t reserved;
+} _fdr_column_desc;
+
+/**
+ * @brief Column schema written by the simulator. Encoding is set at runtime, delta encoding
+ *        only applies to the columns marked as counters.
+ */
+static const struct {
+    const char *name;
+    uint8_t width;
+    uint8_t fixed;
+    bool counter;
+} fdr_schema[FDR_TOTAL_COLUMNS] = {
+    { "Status",          1, 0, false },
+    { "Flight_time",     8, 1, true  },
+    { "Miles_travelled", 8, 1, true  },
+    { "Battery_soc",     4, 1, false },
+    { "Charger_id",      4, 0, false },
+    { "Charge_time",     8, 1, true  },
+    { "Fault_count",     4, 0, true  },
+    { "Charge_sessions", 4, 0, true  }
+};
+
+#endif //_FDR_FORMAT_
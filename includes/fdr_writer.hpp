@@ -0,0 +1,86 @@
+#ifndef _FDR_WRITER_
+#define _FDR_WRITER_
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include "../includes/fdr_format.hpp"
+
+using namespace std;
+
+#define FDR_BUFFER_BYTES        (1 << 20)        // snapshot buffer size for the event engine
+#define FDR_LATE_TOLERANCE      (50)             // msec past the sample interval before a sample counts as late
+
+/**
+ * @brief Snapshot buffer. Holds whole samples back to back, each sample is the timestamp
+ *        followed by the raw column values of every aircraft (column major).
+ *
+ * @var values Sample storage, preallocated for the buffer capacity.
+ * @var count Number of samples in the buffer.
+ */
+typedef struct FDR_BUFFER {
+    vector<int64_t> values;
+    int count;
+} _fdr_buffer;
+
+/**
+ * @class fdr_writer
+ * @brief Asynchronous double buffered flight data recorder. The simulation copies raw
+ *        column values into the active buffer, a dedicated writer thread encodes full
+ *        buffers (text or binary) and writes them to disk. The simulation never touches
+ *        the output stream. When both buffers are busy a lossless writer makes the
+ *        simulation wait for the writer, otherwise the sample is dropped and counted.
+ */
+class fdr_writer {
+    private:
+        ofstream *out;
+        _fdr_format format;
+        int aircrafts;
+        size_t sample_words;                   // int64 words per sample
+        int per_buffer;                        // samples per buffer
+        bool lossless;                         // wait for the writer instead of dropping
+        _fdr_buffer buffers[2];
+        int active;                            // buffer filled by the simulation
+        bool busy[2];                          // buffer handed to the writer thread
+        bool stop;
+        bool running;
+        mutex lock;
+        condition_variable ready_cv;           // signalled when a buffer is handed to the writer
+        condition_variable free_cv;            // signalled when the writer returns a buffer
+        thread worker;
+        // writer thread only
+        vector<string> company;                // company name per aircraft, text format
+        vector<int64_t> prev;                  // last values per column and aircraft, delta encoding
+        vector<char> encoded;
+        // counters
+        atomic<unsigned long> written;
+        atomic<unsigned long> dropped;
+        atomic<unsigned long> late;
+
+        void writer_loop();
+        void write_buffer(_fdr_buffer *buf);
+        bool hand_off(bool wait);
+    public:
+        fdr_writer();
+        ~fdr_writer();
+        fdr_writer(const fdr_writer &) = delete;
+        fdr_writer &operator=(const fdr_writer &) = delete;
+
+        void start(ofstream *o, _fdr_format f, const vector<string> &names, int samples_per_buffer, bool wait);
+        int64_t *begin_sample(int64_t stamp);
+        void end_sample();
+        void finish();
+
+        bool is_running() { return running; }
+        void note_late() { late.fetch_add(1, memory_order_relaxed); }
+        unsigned long get_written() { return written.load(memory_order_relaxed); }
+        unsigned long get_dropped() { return dropped.load(memory_order_relaxed); }
+        unsigned long get_late() { return late.load(memory_order_relaxed); }
+};
+
+#endif //_FDR_WRITER_
@@ -0,0 +1,210 @@
+#ifndef _INSTRUMENT_
+#define _INSTRUMENT_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+using namespace std;
+using namespace std::chrono;
+
+// Instrumented services
+typedef enum INSTR_PROBE {
+    PROBE_SIMULATION=0,             // fleet step, simulation_service tick
+    PROBE_CHARGING,                 // charging_update
+    PROBE_FAULTS,                   // fault dispatch
+    PROBE_FDR,                      // flight data snapshot
+    PROBE_DES_EVENT,                // one event of the event engine
+    TOTAL_PROBES
+} _instr_probe;
+
+// Sampled levels
+typedef enum INSTR_GAUGE {
+    GAUGE_CHARGE_QUEUE=0,           // messages drained from the charge queue per charging step
+    GAUGE_CHARGE_WAITING,           // aircraft waiting for a charger after a charging step
+    TOTAL_GAUGES
+} _instr_gauge;
+
+#ifdef EVTOL_INSTRUMENT
+
+#define HIST_SUB_BITS           (5)                              // 16 linear buckets per power of two, <= 6.25% error
+#define HIST_SUB_COUNT          (1 << HIST_SUB_BITS)
+#define HIST_HALF_COUNT         (HIST_SUB_COUNT / 2)
+#define HIST_BUCKETS            ((64 - HIST_SUB_BITS + 1) * HIST_HALF_COUNT + HIST_HALF_COUNT)
+
+/**
+ * @class log_histogram
+ * @brief HDR style histogram of non-negative integer values. Values below 32 have their
+ *        own bucket, above that every power of two is split in 16 linear buckets, so a
+ *        quantile is at most 1/16 (6.25%) below the true value and the memory is fixed.
+ *        Recording is one relaxed atomic increment, safe from any thread.
+ */
+class log_histogram {
+    private:
+        atomic<uint64_t> counts[HIST_BUCKETS];
+        atomic<uint64_t> total;
+        atomic<uint64_t> sum;
+        atomic<uint64_t> peak;
+
+        static int bucket_of(uint64_t v) {
+            if(v < HIST_SUB_COUNT) {
+                return (int)v;
+            }
+            int shift = (63 - __builtin_clzll(v)) - (HIST_SUB_BITS - 1);
+            return shift * HIST_HALF_COUNT + (int)(v >> shift);
+        }
+
+        static uint64_t bucket_floor(int b) {
+            if(b < HIST_SUB_COUNT) {
+                return (uint64_t)b;
+            }
+            int shift = b / HIST_HALF_COUNT - 1;
+            return (uint64_t)(b - shift * HIST_HALF_COUNT) << shift;
+        }
+    public:
+        log_histogram() { reset(); }
+
+        void reset() {
+            for(auto &c: counts) {
+                c.store(0, memory_order_relaxed);
+            }
+            total.store(0, memory_order_relaxed);
+            sum.store(0, memory_order_relaxed);
+            peak.store(0, memory_order_relaxed);
+        }
+
+        void record(uint64_t v) {
+            counts[bucket_of(v)].fetch_add(1, memory_order_relaxed);
+            total.fetch_add(1, memory_order_relaxed);
+            sum.fetch_add(v, memory_order_relaxed);
+            uint64_t p = peak.load(memory_order_relaxed);
+            while((v > p) && !peak.compare_exchange_weak(p, v, memory_order_relaxed));
+        }
+
+        uint64_t count() { return total.load(memory_order_relaxed); }
+        uint64_t max_value() { return peak.load(memory_order_relaxed); }
+        double mean() {
+            uint64_t n = count();
+            return n ? ((double)sum.load(memory_order_relaxed) / n) : 0.0;
+        }
+
+        /**
+         * @brief Value at quantile q (0 to 1), the lower edge of the bucket it falls in.
+         */
+        uint64_t quantile(double q) {
+            uint64_t n = count();
+            if(n == 0) {
+                return 0;
+            }
+            uint64_t rank = (uint64_t)(q * (n - 1));
+            uint64_t seen = 0;
+            for(int b=0; b<HIST_BUCKETS; b++) {
+                seen += counts[b].load(memory_order_relaxed);
+                if(seen > rank) {
+                    return min(bucket_floor(b), max_value());
+                }
+            }
+            return max_value();
+        }
+};
+
+/**
+ * @brief Instrumentation of one service.
+ *
+ * @var calls Calls made.
+ * @var duration Time per call in nsec.
+ * @var lateness How much later than its interval a periodic service ran, in nsec.
+ * @var last_tick Wall time of the previous periodic call in nsec, 0 before the first.
+ */
+typedef struct INSTR_PROBE_DATA {
+    atomic<uint64_t> calls;
+    log_histogram duration;
+    log_histogram lateness;
+    atomic<int64_t> last_tick;
+} _instr_probe_data;
+
+/**
+ * @brief Sampled level, current value, maximum and distribution.
+ *
+ * @var current Last sampled value.
+ * @var level Distribution of the sampled values.
+ */
+typedef struct INSTR_GAUGE_DATA {
+    atomic<uint64_t> current;
+    log_histogram level;
+} _instr_gauge_data;
+
+extern _instr_probe_data instr_probes[TOTAL_PROBES];
+extern _instr_gauge_data instr_gauges[TOTAL_GAUGES];
+extern atomic<bool> instr_enabled;
+
+static inline int64_t instr_now() {
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @class instr_scope
+ * @brief Times the enclosing scope into the duration histogram of a probe.
+ */
+class instr_scope {
+    private:
+        _instr_probe probe;
+        int64_t start;
+    public:
+        explicit instr_scope(_instr_probe p) : probe(p), start(instr_enabled.load(memory_order_relaxed) ? instr_now() : -1) {}
+        ~instr_scope() {
+            if(start >= 0) {
+                instr_probes[probe].calls.fetch_add(1, memory_order_relaxed);
+                instr_probes[probe].duration.record((uint64_t)(instr_now() - start));
+            }
+        }
+};
+
+/**
+ * @brief Records how late a periodic service runs compared to its interval.
+ *
+ * @param p Probe of the service.
+ * @param interval Nominal interval, wall time.
+ */
+static inline void instr_tick(_instr_probe p, nanoseconds interval) {
+    if(instr_enabled.load(memory_order_relaxed)) {
+        int64_t now = instr_now();
+        int64_t last = instr_probes[p].last_tick.exchange(now, memory_order_relaxed);
+        if(last > 0) {
+            int64_t late = (now - last) - interval.count();
+            instr_probes[p].lateness.record((late > 0) ? (uint64_t)late : 0);
+        }
+    }
+}
+
+/**
+ * @brief Samples a gauge.
+ */
+static inline void instr_gauge(_instr_gauge g, uint64_t v) {
+    if(instr_enabled.load(memory_order_relaxed)) {
+        instr_gauges[g].current.store(v, memory_order_relaxed);
+        instr_gauges[g].level.record(v);
+    }
+}
+
+void instr_reset();
+void instr_report(ostream &out);
+
+#define INSTR_SCOPE(p)          instr_scope _instr_scope_(p)
+#define INSTR_TICK(p, interval) instr_tick(p, interval)
+#define INSTR_GAUGE(g, v)       instr_gauge(g, v)
+#define INSTR_ENABLE(on)        instr_enabled.store(on, memory_order_relaxed)
+#define INSTR_REPORT(out)       instr_report(out)
+
+#else   // compiled out, no code and no data
+
+#define INSTR_SCOPE(p)          do {} while(0)
+#define INSTR_TICK(p, interval) do {} while(0)
+#define INSTR_GAUGE(g, v)       do {} while(0)
+#define INSTR_ENABLE(on)        do {} while(0)
+#define INSTR_REPORT(out)       do {} while(0)
+
+#endif //EVTOL_INSTRUMENT
+
+#endif //_INSTRUMENT_
@@ -0,0 +1,201 @@
+#ifndef _LIVE_STATS_
+#define _LIVE_STATS_
+
+#include <atomic>
+#include <cstdint>
+#include <cmath>
+#include <sched.h>
+#include "../includes/ckpt_stream.hpp"
+
+using namespace std;
+
+#define LIVE_FIXED_SCALE        (1000000.0)      // counters are kept in 1e-6 units
+#define LIVE_SNAPSHOT_SPINS     (64)             // pauses before a snapshot reader yields its core
+#define LIVE_SNAPSHOT_RETRIES   (1024)           // reads of a company before its counters are taken as they are
+
+/**
+ * @brief Tells the core a snapshot reader is spinning, so the writers it waits for run faster.
+ */
+static inline void live_pause() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Per company counters, updated on aircraft state transitions
+typedef enum LIVE_COUNTER {
+    LIVE_AIRCRAFTS=0,               // aircraft in the fleet
+    LIVE_SEGMENTS,                  // flight segments completed (battery limit or fault)
+    LIVE_FLIGHT_TIME,               // hours flown in completed segments
+    LIVE_MILES,                     // miles flown in completed segments
+    LIVE_CHARGE_TIME,               // hours on a charger in ended sessions
+    LIVE_CHARGE_SESSIONS,           // charge sessions started, incomplete ones are taken back
+    LIVE_FAULTS,                    // faults taken
+    TOTAL_LIVE_COUNTERS
+} _live_counter;
+
+/**
+ * @class live_stats
+ * @brief Per company accumulators updated incrementally while the simulation runs.
+ *        Writers never block: every counter is an atomic fixed point integer, so
+ *        concurrent updates from the fleet workers commute and the totals do not
+ *        depend on thread timing. An update only touches one company, and every company
+ *        has its own sequence counters on its own cache line (writers bump active around
+ *        the update and version after it), so workers updating different companies never
+ *        share a line. A reader retries a company while an update of it is in flight, so
+ *        it never sees half of an update. The retries are bounded: under a steady stream
+ *        of updates the reader takes the counters of that company as they are, each one
+ *        still read atomically.
+ *
+ * @tparam N Number of companies.
+ */
+template <int N>
+class live_stats {
+    private:
+        struct alignas(64) counters {
+            atomic<int64_t> value[TOTAL_LIVE_COUNTERS];
+            atomic<unsigned long> active;               // updates of the company in flight
+            atomic<unsigned long> version;              // completed updates of the company
+        };
+        counters company[N];
+
+        void begin(int c) {
+            company[c].active.fetch_add(1, memory_order_relaxed);
+            atomic_thread_fence(memory_order_release);  // a reader that sees any put also sees active raised
+        }
+        void end(int c) {
+            company[c].version.fetch_add(1, memory_order_release);
+            company[c].active.fetch_sub(1, memory_order_release);
+        }
+
+        /**
+         * @brief Copies the counters of one company, retrying while an update of it is in flight.
+         *
+         * @return Completed updates of the company included in the copy.
+         */
+        unsigned long read_company(int c, double *out) {
+            counters &cc = company[c];
+            unsigned long v1 = 0, v2 = 0, busy = 0;
+            for(int tries=0; tries<LIVE_SNAPSHOT_RETRIES; tries++) {
+                for(int spin=0; cc.active.load(memory_order_acquire) != 0; spin++) {
+                    if(spin < LIVE_SNAPSHOT_SPINS) {
+                        live_pause();
+                    } else {
+                        sched_yield();
+                    }
+                }
+                v1 = cc.version.load(memory_order_acquire);
+                for(int k=0; k<TOTAL_LIVE_COUNTERS; k++) {
+                    out[k] = cc.value[k].load(memory_order_relaxed) / LIVE_FIXED_SCALE;
+                }
+                atomic_thread_fence(memory_order_acquire);
+                busy = cc.active.load(memory_order_acquire);
+                v2 = cc.version.load(memory_order_relaxed);
+                if((busy == 0) && (v1 == v2)) {
+                    break;
+                }
+                live_pause();
+            }
+            return v1;
+        }
+        void put(int c, int k, double v) {
+            company[c].value[k].fetch_add(llround(v * LIVE_FIXED_SCALE), memory_order_relaxed);
+        }
+    public:
+        /**
+         * @brief Snapshot of all counters, in natural units.
+         *
+         * @var version Updates included in the snapshot.
+         * @var value Counter values per company and _live_counter.
+         */
+        typedef struct SNAPSHOT {
+            unsigned long version;
+            double value[N][TOTAL_LIVE_COUNTERS];
+        } snapshot_t;
+
+        live_stats() { reset(); }
+        live_stats(const live_stats &) = delete;
+        live_stats &operator=(const live_stats &) = delete;
+
+        /**
+         * @brief Zeroes all counters. Not thread safe, call before the run starts.
+         */
+        void reset() {
+            for(auto &c: company) {
+                for(auto &v: c.value) {
+                    v.store(0, memory_order_relaxed);
+                }
+                c.active.store(0, memory_order_relaxed);
+                c.version.store(0, memory_order_relaxed);
+            }
+        }
+
+        /**
+         * @brief Adds v to one counter of a company.
+         */
+        void add(int c, _live_counter k, double v) {
+            begin(c);
+            put(c, k, v);
+            end(c);
+        }
+
+        /**
+         * @brief Books a completed flight segment, segment count, hours and miles in one update.
+         */
+        void add_segment(int c, double hours, double miles) {
+            begin(c);
+            put(c, LIVE_SEGMENTS, 1);
+            put(c, LIVE_FLIGHT_TIME, hours);
+            put(c, LIVE_MILES, miles);
+            end(c);
+        }
+
+        /**
+         * @brief Writes the raw counters to a checkpoint. Not thread safe, call between steps.
+         */
+        void save(ckpt_writer *w) {
+            for(auto &c: company) {
+                for(auto &v: c.value) {
+                    w->put<int64_t>(v.load(memory_order_relaxed));
+                }
+                w->put<uint64_t>(c.version.load(memory_order_relaxed));
+            }
+        }
+
+        /**
+         * @brief Restores the counters written by save(). Not thread safe.
+         *
+         * @return False if the checkpoint is damaged.
+         */
+        bool load(ckpt_reader *r) {
+            int64_t x = 0;
+            uint64_t ver = 0;
+            for(auto &c: company) {
+                for(auto &v: c.value) {
+                    r->get(&x);
+                    v.store(x, memory_order_relaxed);
+                }
+                r->get(&ver);
+                c.version.store(ver, memory_order_relaxed);
+                c.active.store(0, memory_order_relaxed);
+            }
+            return r->good();
+        }
+
+        /**
+         * @brief Copies a snapshot of all counters, each company consistent on its own.
+         *        Safe from any thread while writers are running.
+         *
+         * @param s Filled with the snapshot.
+         */
+        void snapshot(snapshot_t *s) {
+            s->version = 0;
+            for(int c=0; c<N; c++) {
+                s->version += read_company(c, s->value[c]);
+            }
+        }
+};
+
+#endif //_LIVE_STATS_
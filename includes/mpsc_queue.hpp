@@ -0,0 +1,127 @@
+#ifndef _MPSC_QUEUE_
+#define _MPSC_QUEUE_
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * @class mpsc_queue
+ * @brief Bounded lock-free multi-producer single-consumer queue of by-value entries.
+ *        The ring buffer is allocated once by init(), push/pop never allocate. Each cell
+ *        carries a sequence number: producers claim a slot with a CAS on the enqueue
+ *        position and publish it with a release store of the sequence, the single
+ *        consumer acquires the sequence before reading the entry.
+ *        Ref: Dmitry Vyukov, bounded MPMC queue (restricted here to one consumer).
+ */
+template <typename T>
+class mpsc_queue {
+    private:
+        struct cell {
+            atomic<size_t> seq;
+            T data;
+        };
+        unique_ptr<cell[]> buffer;
+        size_t mask;
+        alignas(64) atomic<size_t> enqueue_pos;        // shared by producers
+        alignas(64) atomic<size_t> dequeue_pos;        // written by the consumer only
+    public:
+        mpsc_queue() : mask(0), enqueue_pos(0), dequeue_pos(0) {}
+        mpsc_queue(const mpsc_queue &) = delete;
+        mpsc_queue &operator=(const mpsc_queue &) = delete;
+
+        /**
+         * @brief Allocates the ring buffer and resets the queue. Not thread safe, call
+         *        before any producer or consumer is running.
+         *
+         * @param capacity Minimum number of entries, rounded up to a power of two.
+         */
+        void init(size_t capacity) {
+            size_t size = 2;
+            while(size < capacity) {
+                size <<= 1;
+            }
+            if(!buffer || (mask + 1 != size)) {
+                buffer.reset(new cell[size]);           // same size on a reused queue keeps the buffer
+            }
+            for(size_t i=0; i<size; i++) {
+                buffer[i].seq.store(i, memory_order_relaxed);
+            }
+            mask = size - 1;
+            enqueue_pos.store(0, memory_order_relaxed);
+            dequeue_pos.store(0, memory_order_relaxed);
+        }
+
+        /**
+         * @brief Adds an entry. Safe to call from any number of threads.
+         *
+         * @param v Entry to copy into the queue.
+         *
+         * @return False if the queue is full.
+         */
+        bool push(const T &v) {
+            cell *c;
+            size_t pos = enqueue_pos.load(memory_order_relaxed);
+            while(true) {
+                c = &buffer[pos & mask];
+                size_t seq = c->seq.load(memory_order_acquire);
+                intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+                if(dif == 0) {
+                    if(enqueue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                        break;
+                    }
+                } else if(dif < 0) {
+                    return false;                       // full
+                } else {
+                    pos = enqueue_pos.load(memory_order_relaxed);
+                }
+            }
+            c->data = v;
+            c->seq.store(pos + 1, memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Removes the oldest entry. Consumer thread only.
+         *
+         * @param v Filled with the entry.
+         *
+         * @return False if the queue is empty.
+         */
+        bool pop(T &v) {
+            size_t pos = dequeue_pos.load(memory_order_relaxed);
+            cell *c = &buffer[pos & mask];
+            size_t seq = c->seq.load(memory_order_acquire);
+            if((intptr_t)seq - (intptr_t)(pos + 1) < 0) {
+                return false;                           // empty
+            }
+            v = c->data;
+            c->seq.store(pos + mask + 1, memory_order_release);
+            dequeue_pos.store(pos + 1, memory_order_relaxed);
+            return true;
+        }
+
+        /**
+         * @brief Checks for a published entry at the head. Consumer thread only.
+         */
+        bool empty() {
+            size_t pos = dequeue_pos.load(memory_order_relaxed);
+            return (intptr_t)buffer[pos & mask].seq.load(memory_order_acquire) - (intptr_t)(pos + 1) < 0;
+        }
+
+        /**
+         * @brief Approximate number of entries, may include claimed but unpublished slots.
+         */
+        size_t size_approx() {
+            size_t head = dequeue_pos.load(memory_order_relaxed);
+            size_t tail = enqueue_pos.load(memory_order_relaxed);
+            return (tail > head) ? (tail - head) : 0;
+        }
+
+        size_t capacity() { return mask + 1; }
+};
+
+#endif //_MPSC_QUEUE_
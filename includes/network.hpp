@@ -0,0 +1,89 @@
+#ifndef _NETWORK_
+#define _NETWORK_
+
+#include "../includes/sim_context.hpp"
+#include "../includes/ac_simul.hpp"
+#include "../includes/event_engine.hpp"
+#include "../includes/worker_pool.hpp"
+#include "../includes/philox.hpp"
+#include <vector>
+
+/**
+ * @brief Vertiport of the network model, one partition of the event engine. Holds its own
+ *        charger pool, charge queue and event queue, and owns the aircraft parked, charging
+ *        or in maintenance there and the ones flying towards it. Each vertiport owns a full
+ *        cache line, partitions on different workers never share one.
+ *
+ * @var id Site number.
+ * @var x Position east in miles.
+ * @var y Position north in miles.
+ * @var chargers Charger pool of the site, cfg.chargers chargers.
+ * @var charge_queue Charge requests and charger releases of the aircraft at the site.
+ * @var events Pending events of the site, min-heap ordered by _event_later.
+ * @var seq Next event sequence number.
+ * @var charger_clock Time the chargers were last advanced to.
+ * @var changed Aircraft whose charge signal changed in a charging step, reused by every step.
+ * @var outbox Aircraft that took off for another site in the current window.
+ * @var departures Flight legs started at the site.
+ * @var landings Flight legs ended at the site.
+ * @var peak_waiting Most aircraft waiting for a charger at once.
+ */
+typedef struct alignas(CACHE_LINE_SIZE) VERTIPORT {
+    int id;
+    double x;
+    double y;
+    charger chargers;
+    mpsc_queue<_c_queue_entry> charge_queue;
+    vector<_sim_event> events;
+    unsigned long seq;
+    milliseconds charger_clock;
+    vector<int> changed;
+    vector<int> outbox;
+    long departures;
+    long landings;
+    size_t peak_waiting;
+} _vertiport;
+
+/**
+ * @brief Network of vertiports on a square grid. Sites are simulated in parallel in
+ *        windows no longer than the lookahead, the shortest flight between two sites.
+ *        An aircraft taking off for another site within a window can't land before the
+ *        window ends, so it is handed to its destination at the window boundary and no
+ *        site ever receives an event in its past (conservative synchronization).
+ *
+ * @var ctx Pointer to the simulation context.
+ * @var sites Vertiports, indexed by site number.
+ * @var columns Sites per grid row.
+ * @var site_miles Grid spacing in miles.
+ * @var lookahead Shortest flight time between two sites, the window length.
+ * @var reach Destinations within range, by site and company, ranges given by reach_begin.
+ * @var reach_begin First destination in reach of site * TOTAL_CATEGORIES + company, one more entry at the end.
+ * @var site Site each aircraft is at or flying to, in the context arena.
+ * @var route Random stream of the destinations of each aircraft, in the context arena.
+ * @var last_update Time each aircraft was last advanced to, in the context arena.
+ * @var epoch Per aircraft epoch, bumped on every reschedule to invalidate pending events. In the context arena.
+ * @var end_time Simulation time at which the run ends.
+ * @var windows Synchronization windows run.
+ * @var transfers Aircraft handed to another site.
+ */
+typedef struct NETWORK {
+    _sim_context *ctx;
+    vector<_vertiport> sites;
+    int columns;
+    double site_miles;
+    milliseconds lookahead;
+    vector<int> reach;
+    vector<size_t> reach_begin;
+    int *site;
+    philox_rng *route;
+    milliseconds *last_update;
+    int *epoch;
+    milliseconds end_time;
+    long windows;
+    long transfers;
+} _network;
+
+void network_simulation(_sim_context *ctx, _network *net, milliseconds end_time, worker_pool *pool);
+void network_analysis(_network *net, ofstream &outfile);
+
+#endif //_NETWORK_
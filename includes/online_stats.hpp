@@ -0,0 +1,140 @@
+#ifndef _ONLINE_STATS_
+#define _ONLINE_STATS_
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * @class running_stats
+ * @brief Streaming count, mean, variance, min and max in constant memory.
+ *        Ref: Welford, "Note on a method for calculating corrected sums of squares and products", 1962.
+ */
+class running_stats {
+    private:
+        long n;
+        double mu;
+        double m2;                             // sum of squared differences from the mean
+        double lo;
+        double hi;
+    public:
+        running_stats() : n(0), mu(0), m2(0), lo(numeric_limits<double>::infinity()),
+                          hi(-numeric_limits<double>::infinity()) {}
+
+        void add(double x) {
+            n++;
+            double d = x - mu;
+            mu += d / n;
+            m2 += d * (x - mu);
+            lo = min(lo, x);
+            hi = max(hi, x);
+        }
+
+        long count() { return n; }
+        double mean() { return mu; }
+        double variance() { return (n > 1) ? (m2 / (n - 1)) : 0.0; }
+        double stddev() { return sqrt(variance()); }
+        double min_value() { return (n > 0) ? lo : 0.0; }
+        double max_value() { return (n > 0) ? hi : 0.0; }
+
+        /**
+         * @brief Half width of the normal approximation 95% confidence interval of the mean.
+         */
+        double ci95() { return (n > 1) ? (1.96 * stddev() / sqrt((double)n)) : 0.0; }
+};
+
+/**
+ * @class p2_quantile
+ * @brief Streaming estimate of one quantile from five markers, constant memory and no
+ *        stored samples. Exact for the first five samples.
+ *        Ref: Jain and Chlamtac, "The P2 algorithm for dynamic calculation of quantiles
+ *             and histograms without storing observations", CACM 1985.
+ */
+class p2_quantile {
+    private:
+        double p;                              // quantile, 0 to 1
+        long n;
+        double q[5];                           // marker heights
+        double pos[5];                         // marker positions
+        double want[5];                        // desired marker positions
+        double dn[5];                          // desired position increments
+
+        double parabolic(int i, double d) {
+            return q[i] + d / (pos[i+1] - pos[i-1]) *
+                   ((pos[i] - pos[i-1] + d) * (q[i+1] - q[i]) / (pos[i+1] - pos[i]) +
+                    (pos[i+1] - pos[i] - d) * (q[i] - q[i-1]) / (pos[i] - pos[i-1]));
+        }
+
+        double linear(int i, int d) {
+            return q[i] + d * (q[i+d] - q[i]) / (pos[i+d] - pos[i]);
+        }
+    public:
+        explicit p2_quantile(double quantile=0.5) : p(quantile), n(0) {}
+
+        void add(double x) {
+            if(n < 5) {
+                q[n++] = x;
+                if(n == 5) {
+                    sort(q, q + 5);
+                    for(int i=0; i<5; i++) {
+                        pos[i] = i + 1;
+                    }
+                    want[0] = 1; want[1] = 1 + 2*p; want[2] = 1 + 4*p; want[3] = 3 + 2*p; want[4] = 5;
+                    dn[0] = 0;   dn[1] = p/2;     dn[2] = p;       dn[3] = (1 + p)/2; dn[4] = 1;
+                }
+                return;
+            }
+            int k;
+            if(x < q[0]) {
+                q[0] = x;
+                k = 0;
+            } else if(x >= q[4]) {
+                q[4] = x;
+                k = 3;
+            } else {
+                k = 0;
+                while(x >= q[k+1]) {
+                    k++;
+                }
+            }
+            for(int i=k+1; i<5; i++) {
+                pos[i]++;
+            }
+            for(int i=0; i<5; i++) {
+                want[i] += dn[i];
+            }
+            n++;
+            for(int i=1; i<4; i++) {                    // move the inner markers
+                double d = want[i] - pos[i];
+                if(((d >= 1) && (pos[i+1] - pos[i] > 1)) || ((d <= -1) && (pos[i-1] - pos[i] < -1))) {
+                    int s = (d > 0) ? 1 : -1;
+                    double h = parabolic(i, s);
+                    q[i] = ((q[i-1] < h) && (h < q[i+1])) ? h : linear(i, s);
+                    pos[i] += s;
+                }
+            }
+        }
+
+        double value() {
+            if(n == 0) {
+                return 0.0;
+            }
+            if(n < 5) {
+                double v[5];
+                int m = (int)n;
+                for(int i=0; i<m; i++) {                // insertion sort of the first samples
+                    int j = i;
+                    for(; (j > 0) && (v[j-1] > q[i]); j--) {
+                        v[j] = v[j-1];
+                    }
+                    v[j] = q[i];
+                }
+                return v[min((int)(p * m), m - 1)];
+            }
+            return q[2];
+        }
+};
+
+#endif //_ONLINE_STATS_
@@ -0,0 +1,103 @@
+#ifndef _PHILOX_
+#define _PHILOX_
+
+#include <cstdint>
+#include <cmath>
+
+using namespace std;
+
+/**
+ * @class philox_rng
+ * @brief Counter based random number generator (Philox4x32-10). Every output block is a
+ *        pure function of (seed, stream, counter), so streams are independent of each
+ *        other and of the order or thread they are drawn on. The same seed and stream
+ *        always give the same sequence on every platform.
+ *        Ref: Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3", SC11.
+ */
+class philox_rng {
+    private:
+        uint32_t key[2];                       // master seed
+        uint32_t ctr[4];                       // ctr[0..1] block counter, ctr[2..3] stream id
+        uint32_t out[4];                       // current output block
+        int idx;                               // next unused word of out, 4 when used up
+
+        static inline void mulhilo(uint32_t a, uint32_t b, uint32_t *hi, uint32_t *lo) {
+            uint64_t p = (uint64_t)a * b;
+            *hi = (uint32_t)(p >> 32);
+            *lo = (uint32_t)p;
+        }
+
+        /**
+         * @brief Computes the output block for the current counter and advances the counter.
+         */
+        void generate() {
+            uint32_t c[4] = {ctr[0], ctr[1], ctr[2], ctr[3]};
+            uint32_t k[2] = {key[0], key[1]};
+            for(int round=0; round<10; round++) {
+                uint32_t hi0, lo0, hi1, lo1;
+                mulhilo(0xD2511F53u, c[0], &hi0, &lo0);
+                mulhilo(0xCD9E8D57u, c[2], &hi1, &lo1);
+                uint32_t n[4] = {hi1 ^ c[1] ^ k[0], lo1, hi0 ^ c[3] ^ k[1], lo0};
+                c[0] = n[0]; c[1] = n[1]; c[2] = n[2]; c[3] = n[3];
+                k[0] += 0x9E3779B9u;
+                k[1] += 0xBB67AE85u;
+            }
+            out[0] = c[0]; out[1] = c[1]; out[2] = c[2]; out[3] = c[3];
+            if(++ctr[0] == 0) {
+                ctr[1]++;
+            }
+            idx = 0;
+        }
+    public:
+        philox_rng(uint64_t seed=0, uint64_t stream=0) {
+            set_stream(seed, stream);
+        }
+
+        /**
+         * @brief Restarts the generator at the beginning of a stream.
+         *
+         * @param seed Master seed.
+         * @param stream Stream id, e.g. the aircraft number.
+         */
+        void set_stream(uint64_t seed, uint64_t stream) {
+            key[0] = (uint32_t)seed;
+            key[1] = (uint32_t)(seed >> 32);
+            ctr[0] = 0;
+            ctr[1] = 0;
+            ctr[2] = (uint32_t)stream;
+            ctr[3] = (uint32_t)(stream >> 32);
+            idx = 4;
+        }
+
+        uint32_t next_u32() {
+            if(idx == 4) {
+                generate();
+            }
+            return out[idx++];
+        }
+
+        /**
+         * @brief Uniform double in [0, 1) with 53 random bits.
+         */
+        double uniform() {
+            uint64_t hi = next_u32() >> 5;
+            uint64_t lo = next_u32() >> 6;
+            return (double)((hi << 26) | lo) * (1.0 / 9007199254740992.0);
+        }
+
+        /**
+         * @brief Uniform integer in [0, n), multiply-shift mapping of one 32 bit word.
+         */
+        uint32_t below(uint32_t n) {
+            return (uint32_t)(((uint64_t)next_u32() * n) >> 32);
+        }
+
+        /**
+         * @brief Exponentially distributed value with rate lambda, by inversion.
+         */
+        double exponential(double lambda) {
+            return -log1p(-uniform()) / lambda;
+        }
+};
+
+#endif //_PHILOX_
@@ -0,0 +1,27 @@
+#ifndef _SCENARIO_
+#define _SCENARIO_
+
+#include "../includes/definitions.hpp"
+#include <vector>
+#include <string>
+
+#define SCENARIO_MAX_LINE       (4096)           // longest scenario line
+
+/**
+ * @brief Everything a scenario file defines besides the run configuration.
+ *
+ * @var params Aircraft parameters by company, the built-in ones unless overridden.
+ * @var probs Failure probability per hour by company.
+ * @var manifest Company of every aircraft of an explicit fleet manifest, empty for a drawn mix.
+ */
+typedef struct SCENARIO {
+    _ac_map params;
+    _prob_map probs;
+    vector<uint8_t> manifest;
+} _scenario;
+
+void init_scenario(_scenario *sc);
+bool load_scenario(const string &path, _sim_config *cfg, _scenario *sc, string *err);
+bool load_fleet_manifest(const string &path, vector<uint8_t> *out, string *err);
+
+#endif //_SCENARIO_
@@ -0,0 +1,162 @@
+#ifndef _SIM_ARENA_
+#define _SIM_ARENA_
+
+#include <memory>
+#include <vector>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <algorithm>
+
+using namespace std;
+
+#define ARENA_MIN_BLOCK         (64 * 1024)      // bytes, smallest block the arena allocates
+
+/**
+ * @class sim_arena
+ * @brief Bump allocator for the objects and scratch arrays of one simulation run.
+ *        Allocation is a pointer increment inside the current block, a new block is
+ *        only taken when the current one is full. reset() destroys every object and
+ *        rewinds the arena in one shot; a fragmented arena is merged into one block of
+ *        the combined size, so a reused context runs the next replication without
+ *        touching the heap. Memory is returned by release() or the destructor.
+ *        Not thread safe, allocate during setup from one thread.
+ */
+class sim_arena {
+    private:
+        typedef struct ARENA_BLOCK {
+            unique_ptr<char[]> data;
+            size_t size;
+        } _arena_block;
+        typedef struct ARENA_DTOR {
+            void (*destroy)(void *);
+            void *obj;
+        } _arena_dtor;
+
+        vector<_arena_block> blocks;
+        size_t current;                        // block being filled
+        size_t offset;                         // first free byte in the current block
+        size_t in_use;                         // bytes handed out, including alignment padding
+        vector<_arena_dtor> dtors;             // objects that need their destructor run, in creation order
+
+        template<typename T>
+        static void destroy(void *p) {
+            static_cast<T *>(p)->~T();
+        }
+
+        void destroy_all() {
+            for(auto d = dtors.rbegin(); d != dtors.rend(); ++d) {
+                d->destroy(d->obj);
+            }
+            dtors.clear();
+        }
+
+        void add_block(size_t bytes) {
+            _arena_block b;
+            b.size = max(bytes, (size_t)ARENA_MIN_BLOCK);
+            b.data.reset(new char[b.size]);
+            blocks.push_back(move(b));
+        }
+    public:
+        sim_arena() : current(0), offset(0), in_use(0) {}
+        ~sim_arena() { release(); }
+        sim_arena(const sim_arena &) = delete;
+        sim_arena &operator=(const sim_arena &) = delete;
+
+        /**
+         * @brief Makes sure the arena holds at least bytes without taking another block.
+         *
+         * @param bytes Bytes the run is expected to allocate.
+         */
+        void reserve(size_t bytes) {
+            if(capacity() - in_use < bytes) {
+                add_block(bytes);
+            }
+        }
+
+        /**
+         * @brief Uninitialized memory for n objects of type T, aligned for T.
+         *
+         * @param n Number of objects.
+         *
+         * @return Pointer to the memory, valid until reset() or release().
+         */
+        template<typename T>
+        T *alloc_array(size_t n) {
+            size_t align = alignof(T);
+            size_t bytes = n * sizeof(T);
+            while(true) {
+                if(current < blocks.size()) {
+                    uintptr_t base = (uintptr_t)blocks[current].data.get();
+                    size_t start = ((base + offset + align - 1) & ~(uintptr_t)(align - 1)) - base;
+                    if(start + bytes <= blocks[current].size) {
+                        in_use += (start - offset) + bytes;
+                        offset = start + bytes;
+                        return reinterpret_cast<T *>(base + start);
+                    }
+                    current++;
+                    offset = 0;
+                } else {
+                    add_block(bytes + align);
+                }
+            }
+        }
+
+        /**
+         * @brief Constructs an object in the arena. Its destructor runs on reset() unless
+         *        the type is trivially destructible.
+         *
+         * @param args Constructor arguments.
+         *
+         * @return Pointer to the object, valid until reset() or release().
+         */
+        template<typename T, typename... Args>
+        T *create(Args&&... args) {
+            T *obj = new (alloc_array<T>(1)) T(forward<Args>(args)...);
+            if(!is_trivially_destructible<T>::value) {
+                dtors.push_back({&sim_arena::destroy<T>, obj});
+            }
+            return obj;
+        }
+
+        /**
+         * @brief Destroys every object in reverse creation order and rewinds the arena,
+         *        keeping its memory. Several blocks are merged into one.
+         */
+        void reset() {
+            destroy_all();
+            if(blocks.size() > 1) {
+                size_t total = capacity();
+                blocks.clear();
+                add_block(total);
+            }
+            current = 0;
+            offset = 0;
+            in_use = 0;
+        }
+
+        /**
+         * @brief Destroys every object and frees all memory.
+         */
+        void release() {
+            destroy_all();
+            blocks.clear();
+            vector<_arena_dtor>().swap(dtors);
+            current = 0;
+            offset = 0;
+            in_use = 0;
+        }
+
+        size_t used() { return in_use; }
+
+        size_t capacity() {
+            size_t total = 0;
+            for(auto &b: blocks) {
+                total += b.size;
+            }
+            return total;
+        }
+};
+
+#endif //_SIM_ARENA_
@@ -0,0 +1,82 @@
+#ifndef _SIM_CONTEXT_
+#define _SIM_CONTEXT_
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include "../includes/definitions.hpp"
+#include "../includes/fault_schedule.hpp"
+#include "../includes/fdr_writer.hpp"
+#include "../includes/sim_arena.hpp"
+
+/**
+ * @brief Owns all state of one simulation run. Per-aircraft state is sized from the
+ *        runtime configuration, so memory scales linearly with the fleet.
+ *
+ * @var cfg Runtime configuration.
+ * @var arena Aircraft objects and per-run scratch, released in one shot by delete_aircrafts().
+ * @var fleet Aircraft objects, indexed by aircraft number.
+ * @var store Struct-of-arrays per tick fleet state.
+ * @var mailbox Per aircraft fault/charge messages, one cache line each.
+ * @var terminate false - running, true - terminate. Own cache line, polled by all workers.
+ * @var chargers Charger pool: live status, usage, history and the aircraft waiting for a charger.
+ * @var charge_queue Charge requests and charger releases. Lock-free, pushed from the fleet workers.
+ * @var faults Fault schedule, next fault per aircraft.
+ * @var fdr Asynchronous flight data recorder.
+ * @var live Per company statistics updated during the run, readable from any thread.
+ */
+typedef struct SIM_CONTEXT {
+    _sim_config cfg;
+    sim_arena arena;
+    vector<aircraft*> fleet;
+    _fleet_store store;
+    vector<_ac_mailbox> mailbox;
+    alignas(CACHE_LINE_SIZE) atomic<bool> terminate;
+    charger chargers;
+    mpsc_queue<_c_queue_entry> charge_queue;
+    fault_schedule faults;
+    fdr_writer fdr;
+    _fleet_live_stats live;
+} _sim_context;
+
+void init_sim_context(_sim_context *ctx, const _sim_config &cfg);
+void create_aircrafts(_sim_context *ctx, _ac_map *map, int categories);
+void delete_aircrafts(_sim_context *ctx);
+void fault_injection(_prob_map *pmap, _sim_context *ctx);
+void fault_service(_sim_context *ctx);
+void data_recorder_service(_sim_context *ctx);
+void write_fdr_header(_sim_context *ctx, ofstream &outfile);
+void start_fdr_writer(_sim_context *ctx, ofstream &outfile);
+void stop_fdr_writer(_sim_context *ctx);
+void record_flight_data(_sim_context *ctx, milliseconds stamp);
+ofstream open_log_file(const string &filename, bool binary=false);
+void close_file(ofstream &outfile);
+bool write_to_file(ofstream &outfile, const string &line);
+// Per company results of a run
+typedef enum SIM_METRIC {
+    MET_FLIGHTS=0,
+    MET_AVG_FLIGHT_TIME,
+    MET_AVG_DISTANCE,
+    MET_AVG_CHARGE_TIME,
+    MET_TOTAL_FAULTS,
+    MET_PASSENGER_MILES,
+    TOTAL_METRICS
+} _sim_metric;
+
+/**
+ * @brief Results of a run, the values written by sim_analysis().
+ *
+ * @var value Metric value, indexed by company and _sim_metric.
+ */
+typedef struct SIM_METRICS {
+    double value[TOTAL_CATEGORIES][TOTAL_METRICS];
+} _sim_metrics;
+
+const char *company_name(int company);
+void compute_sim_metrics(_sim_context *ctx, _sim_metrics *m);
+void compute_live_metrics(_fleet_store *fs, _fleet_live_stats::snapshot_t *s, _sim_metrics *m);
+void finish_live_stats(_sim_context *ctx);
+void live_report(_sim_context *ctx, ostream &out);
+void sim_analysis(_sim_context *ctx, int categories, ofstream &outfile);
+
+#endif //_SIM_CONTEXT_
@@ -0,0 +1,40 @@
+#ifndef _SWEEP_
+#define _SWEEP_
+
+#include "../includes/definitions.hpp"
+#include "../includes/batch.hpp"
+#include <vector>
+#include <string>
+
+/**
+ * @brief Parameters a sweep can vary. The company entries follow _ac_company.
+ */
+typedef enum SWEEP_PARAM {
+    SWEEP_ALPHA=0,
+    SWEEP_BRAVO,
+    SWEEP_CHARLIE,
+    SWEEP_DELTA,
+    SWEEP_ECHO,
+    SWEEP_CHARGERS,
+    SWEEP_FAULT,
+    SWEEP_DOWNTIME,
+    SWEEP_SOC,
+    TOTAL_SWEEP_PARAMS
+} _sweep_param;
+
+/**
+ * @brief Values of every swept parameter. A parameter without values keeps the base
+ *        configuration. If any company count is swept, the fleet mix is fixed and the
+ *        companies not listed get no aircraft.
+ *
+ * @var values Grid values per _sweep_param.
+ */
+typedef struct SWEEP_SPEC {
+    vector<double> values[TOTAL_SWEEP_PARAMS];
+} _sweep_spec;
+
+bool parse_sweep_spec(const string &spec, _sweep_spec *sp);
+void build_sweep_points(const _sim_config &base, const _sweep_spec &sp, vector<_sim_config> *points);
+void write_sweep_results(const vector<_sim_config> &points, vector<_batch_result> &res, ostream &out);
+
+#endif //_SWEEP_
@@ -5,10 +5,41 @@
 
 using namespace std::chrono;
 
-void init_Timer(void);
+// Periodic service timers are numbered from 0 in registration order
+typedef int _timer_id;
+
+/**
+ * @brief Pacing of the simulation clock against the wall clock, filled by get_timer_drift().
+ *
+ * @var rate Requested simulation msec per wall msec, 0 when free running.
+ * @var achieved Simulation msec advanced by the fleet per wall msec.
+ * @var wall_ms Wall time since init_Timer() in msec.
+ * @var clock Simulation clock.
+ * @var advanced Simulation time the fleet has been stepped through.
+ * @var lag Clock minus advanced, how far the fleet is behind the clock.
+ * @var max_lag Largest lag seen so far.
+ */
+typedef struct TIMER_DRIFT {
+    double rate;
+    double achieved;
+    double wall_ms;
+    milliseconds clock;
+    milliseconds advanced;
+    milliseconds lag;
+    milliseconds max_lag;
+} _timer_drift;
+
+_timer_id timer_register(milliseconds interval);
+void timer_set_interval(_timer_id id, milliseconds interval);
+int timer_due(_timer_id id);
+void init_Timer(double rate);
 void update_Timer(void);
+void timer_wait(milliseconds limit);
+nanoseconds timer_wall_time(milliseconds sim);
 int convert_to_hours(milliseconds diff, int factor);
 int isduration(milliseconds ref, milliseconds msec);
 void get_counter_val(milliseconds *m);
+void timer_advanced(milliseconds step);
+void get_timer_drift(_timer_drift *d);
 
 #endif //_TIMER_
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef _WORKER_POOL_
+#define _WORKER_POOL_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+using namespace std;
+
+/**
+ * @class worker_pool
+ * @brief Fixed set of worker threads that split a range of work items into contiguous
+ *        slices, one slice per worker. Workers block on a condition variable between
+ *        jobs, so an idle pool does not use any CPU. Thread count is independent of
+ *        the number of work items.
+ */
+class worker_pool {
+    private:
+        vector<thread> workers;
+        int count;                             // number of workers, fixed at construction
+        mutex lock;
+        condition_variable start_cv;           // signalled when a new job is posted
+        condition_variable done_cv;            // signalled when the last slice is done
+        function<void(int, int)> job;          // job for the current generation
+        int total;                             // number of work items in the current job
+        unsigned long generation;              // bumped for every posted job
+        int pending;                           // slices not yet finished
+        bool stop;
+
+        void worker_loop(int id);
+    public:
+        explicit worker_pool(int n);
+        ~worker_pool();
+
+        int size() { return count; }
+        void parallel_for(int items, const function<void(int, int)> &fn);
+};
+
+int default_worker_count(void);
+
+#endif //_WORKER_POOL_
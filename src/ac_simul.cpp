@@ -2,80 +2,314 @@
  * @brief   Aircraft Simulation File  
  * @details This file contains the simulation function for the eVtol simulation problem from Joby Avation.
  *          Fucntions here are used to init the aircraft objects based on set aircrafts and also include 
- *          different services like simulation and charging.
+ *          different services like simulation and charging. The simulation service steps the fleet in
+ *          contiguous slices on a fixed size worker pool.
  * @author  Deepak E Kapure
  * @date    07-02-2025 
  * 
  */
 
 #include "../includes/ac_simul.hpp"
+#include "../includes/instrument.hpp"
+#include "../includes/timer.hpp"
+
+// Local file specific variables
+static _timer_id charging_timer = timer_register(milliseconds(CHARGING_INTERVAL));
+static _timer_id simulation_timer = timer_register(milliseconds(SERVICE_INTERVAL));
 
 /**
- * @brief Macros to define the execution intervals for the simulation and charging service
- *        Units are in milliseconds.
- * 
+ * @brief Initializes a simulation context for the given configuration.
+ *        Sizes the per-aircraft signal arrays and the charger pool and resets the queue state.
+ *        Aircraft objects are created separately by create_aircrafts(). A context can be
+ *        initialized again for the next run, allocations of the same size are reused.
+ *
+ * @param ctx Pointer to the simulation context.
+ * @param cfg Runtime configuration.
+ *
+ * @return None
  */
-#define SERVICE_INTERVAL        (50)
-#define CHARGING_INTERVAL       (25)                     // lower than simulation service to reduce downtime
+void init_sim_context(_sim_context *ctx, const _sim_config &cfg) {
+    if(ctx) {
+        ctx->cfg = cfg;
+        int mixed = 0;
+        for(int i=0; i<TOTAL_CATEGORIES; i++) {
+            mixed += max(0, cfg.mix[i]);
+        }
+        if(cfg.manifest && !cfg.manifest->empty()) {
+            ctx->cfg.aircrafts = (int)cfg.manifest->size(); // explicit manifest sets the fleet size
+        } else if(mixed > 0) {
+            ctx->cfg.aircrafts = mixed;                 // fixed mix sets the fleet size
+        } else if(ctx->cfg.aircrafts < MIN_AIRCRAFTS) {
+            ctx->cfg.aircrafts = MIN_AIRCRAFTS;
+        }
+        ctx->fleet.assign(ctx->cfg.aircrafts, nullptr);
+        init_fleet_store(&ctx->store, ctx->cfg.aircrafts);
+        if(ctx->mailbox.size() != (size_t)ctx->cfg.aircrafts) {
+            ctx->mailbox = vector<_ac_mailbox>(ctx->cfg.aircrafts);
+        } else {
+            for(auto &mb: ctx->mailbox) {               // reused context, keep the allocation
+                mb.faults.store(0, memory_order_relaxed);
+                mb.charge.store(0, memory_order_relaxed);
+            }
+        }
+        ctx->terminate.store(false, memory_order_relaxed);
+        ctx->chargers.init(ctx->cfg.chargers, ctx->cfg.policy);
+        ctx->charge_queue.init((size_t)ctx->cfg.aircrafts * CHARGE_QUEUE_PER_AIRCRAFT);
+        ctx->faults.clear();
+        ctx->live.reset();
+    }
+}
 
 /**
- * @brief Global flags for fault, termination and charge signalling
- * 
+ * @brief Fills a configuration with the simulation defaults.
+ *
+ * @param cfg Pointer to the configuration.
+ *
+ * @return None
  */
-// 0 - no fault, 1 - fault, 2 - fault during charging (to notify charging service)
-int fault_signals[TOTAL_AIRCRAFTS] = {0};
-// 0 = not charging/done charging, 1,2,3 = on charging with resp charger 
-int charge_signals[TOTAL_AIRCRAFTS] = {0};
-// false - running, true - terminate
-bool global_terminate = false;
+void default_sim_config(_sim_config *cfg) {
+    if(cfg) {
+        cfg->aircrafts = DEFAULT_AIRCRAFTS;
+        cfg->sim_hours = DEFAULT_SIMULATION_HRS;
+        cfg->realtime = false;
+        cfg->time_scale = DEFAULT_TIME_SCALE;
+        cfg->workers = default_worker_count();
+        cfg->chargers = DEFAULT_CHARGERS;
+        cfg->charger_power = 1.0;
+        cfg->policy = DISPATCH_FIFO;
+        cfg->fdr_format = FDR_TEXT;
+        cfg->seed = 0;
+        cfg->log_inputs = true;
+        cfg->dump_faults = false;
+        cfg->live_interval = 0;
+        cfg->replications = 0;
+        for(int i=0; i<TOTAL_CATEGORIES; i++) {
+            cfg->mix[i] = 0;
+        }
+        cfg->fault_scale = 1.0;
+        cfg->downtime_hours = DOWNTIME_HOURS;
+        cfg->soc_threshold = BATTERY_SOC_THREASHOLD;
+        cfg->fdr_interval = FDR_INTERVAL;
+        cfg->manifest = nullptr;
+        cfg->checkpoint_hours = 0;
+        cfg->checkpoint_file = nullptr;
+        cfg->sites = 0;
+        cfg->site_miles = DEFAULT_SITE_MILES;
+    }
+}
 
-// Local file specific variables
-static milliseconds charging_ref(0);
+/**
+ * @brief Sizes the fleet store arrays for the given fleet.
+ *
+ * @param fs Pointer to the fleet store.
+ * @param size Number of aircraft.
+ *
+ * @return None
+ */
+void init_fleet_store(_fleet_store *fs, int size) {
+    if(fs) {
+        fs->flight_time.assign(size, 0.0);
+        fs->miles_travelled.assign(size, 0.0);
+        fs->bat_cap_used.assign(size, 0.0);
+        fs->battery_soc.assign(size, 100.0);
+        fs->status.assign(size, STANDBY);
+        fs->company.assign(size, ALPHA);
+        fs->energy_per_ms.assign(size, 0.0);
+        fs->cap_per_soc.assign(size, 1.0);
+        fs->miles_per_ms.assign(size, 0.0);
+        fs->bat_cap_limit.assign(size, 0.0);
+        for(int c=0; c<TOTAL_CATEGORIES; c++) {
+            fs->spec[c] = company_specs[c];
+        }
+        fs->runs.clear();                               // generic kernel until create_aircrafts() sets the runs
+    }
+}
+
+/**
+ * @brief In-flight advancement kernel over plain arrays. Kept separate from the fleet
+ *        store so the restrict qualified arrays let the compiler vectorize the loop.
+ *        Cruise speed and energy per mile are constant, so a flight segment is linear in
+ *        time: each aircraft flies min(dt, time left to its battery limit) in closed form
+ *        and lands exactly on the limit instead of overshooting by part of a step.
+ *        Aircraft not IN_FLIGHT are multiplied by zero instead of branching. Battery soc
+ *        is recomputed for all, it only changes together with the used capacity.
+ *
+ * @param flight_time Flight time per aircraft (hours).
+ * @param miles Miles travelled per aircraft.
+ * @param bat_used Used battery capacity per aircraft.
+ * @param soc Battery soc per aircraft.
+ * @param status Status per aircraft.
+ * @param energy Energy used per msec per aircraft.
+ * @param per_soc Battery capacity per % soc per aircraft.
+ * @param speed Miles per msec per aircraft.
+ * @param limit Used battery capacity at the soc threshold per aircraft.
+ * @param begin First aircraft.
+ * @param end One past the last aircraft.
+ * @param dt Time step in msec.
+ *
+ * @return None
+ */
+static void integrate_flight_kernel(double *__restrict__ flight_time, double *__restrict__ miles,
+                                    double *__restrict__ bat_used, double *__restrict__ soc,
+                                    const int8_t *__restrict__ status, const double *__restrict__ energy,
+                                    const double *__restrict__ per_soc, const double *__restrict__ speed,
+                                    const double *__restrict__ limit, int begin, int end, double dt) {
+    for(int i=begin; i<end; i++) {
+        double left = max((limit[i] - bat_used[i]) / energy[i], 0.0);
+        bool ends = (dt >= left);                       // segment ends within this step
+        double step = (ends ? left : dt) * (double)(status[i] == IN_FLIGHT);
+        flight_time[i] += step * SIM_MS_TO_HOURS;
+        miles[i] += step * speed[i];
+        bat_used[i] = (ends && (status[i] == IN_FLIGHT)) ? max(limit[i], bat_used[i]) : (bat_used[i] + step * energy[i]);
+        soc[i] = 100 - (bat_used[i] / per_soc[i]);
+    }
+}
+
+/**
+ * @brief In-flight advancement kernel of a built-in company. Same math as
+ *        integrate_flight_kernel(), with energy, speed and capacity per soc folded in as
+ *        compile time constants, so only the state arrays are streamed.
+ *
+ * @param flight_time Flight time per aircraft (hours).
+ * @param miles Miles travelled per aircraft.
+ * @param bat_used Used battery capacity per aircraft.
+ * @param soc Battery soc per aircraft.
+ * @param status Status per aircraft.
+ * @param limit Used battery capacity at the soc threshold per aircraft.
+ * @param begin First aircraft.
+ * @param end One past the last aircraft.
+ * @param dt Time step in msec.
+ *
+ * @return None
+ */
+template<int C>
+static void integrate_company_kernel(double *__restrict__ flight_time, double *__restrict__ miles,
+                                     double *__restrict__ bat_used, double *__restrict__ soc,
+                                     const int8_t *__restrict__ status, const double *__restrict__ limit,
+                                     int begin, int end, double dt) {
+    constexpr double energy = company_traits<C>::energy_per_ms;
+    constexpr double per_soc = company_traits<C>::cap_per_soc;
+    constexpr double speed = company_traits<C>::miles_per_ms;
+    for(int i=begin; i<end; i++) {
+        double left = max((limit[i] - bat_used[i]) / energy, 0.0);
+        bool ends = (dt >= left);                       // segment ends within this step
+        double step = (ends ? left : dt) * (double)(status[i] == IN_FLIGHT);
+        flight_time[i] += step * SIM_MS_TO_HOURS;
+        miles[i] += step * speed;
+        bat_used[i] = (ends && (status[i] == IN_FLIGHT)) ? max(limit[i], bat_used[i]) : (bat_used[i] + step * energy);
+        soc[i] = 100 - (bat_used[i] / per_soc);
+    }
+}
 
-// Obecjts to keep track of live charging status of chargers
-static _c_live_info charger1_live = {READY_TO_CHARGE, -1, 0};
-static _c_live_info charger2_live = {READY_TO_CHARGE, -1, 0};
-static _c_live_info charger3_live = {READY_TO_CHARGE, -1, 0};
+// Compile time kernels of the built-in companies, indexed by _ac_type
+typedef void (*_company_kernel)(double *, double *, double *, double *, const int8_t *, const double *, int, int, double);
+static const _company_kernel company_kernels[TOTAL_CATEGORIES] = {
+    integrate_company_kernel<ALPHA>,
+    integrate_company_kernel<BRAVO>,
+    integrate_company_kernel<CHARLIE>,
+    integrate_company_kernel<DELTA>,
+    integrate_company_kernel<ECHO>
+};
 
 /**
- * @brief Function to init threads for simulation
- * 
- * @param th_pool vector to store pointers to threads
- * @param total_ac total number of aircrafts
- * @param ac_array vector to store AC objects
- * @param cq charging queue pointer 
- * 
+ * @brief Advances [begin, end) of the fleet with the generic per aircraft kernel.
+ */
+static void integrate_generic(_fleet_store *fs, int begin, int end, double dt) {
+    integrate_flight_kernel(fs->flight_time.data(), fs->miles_travelled.data(), fs->bat_cap_used.data(),
+                            fs->battery_soc.data(), fs->status.data(), fs->energy_per_ms.data(),
+                            fs->cap_per_soc.data(), fs->miles_per_ms.data(), fs->bat_cap_limit.data(),
+                            begin, end, dt);
+}
+
+/**
+ * @brief Advances flight time, miles and battery of every IN_FLIGHT aircraft in
+ *        [begin, end) by t, or up to the end of its flight segment if that comes first,
+ *        in one streaming pass over the fleet store. Each company run of the range is
+ *        dispatched to its compile time kernel, companies loaded with a custom
+ *        specification take the generic kernel.
+ *
+ * @param fs Pointer to the fleet store.
+ * @param begin First aircraft.
+ * @param end One past the last aircraft.
+ * @param t Time step.
+ *
  * @return None
- * 
  */
-void spawn_threads(vector<thread> *th_pool, int total_ac, aircraft **ac_array, queue<_c_queue_entry*> *cq) {
-    if(th_pool && ac_array) {
-        for(auto th=0; th<total_ac; th++) {
-            th_pool->emplace_back(aircraft_simul, th, ac_array[th], cq);
+void fleet_integrate_flight(_fleet_store *fs, int begin, int end, milliseconds t) {
+    if(fs && (begin < end)) {
+        double dt = (double)t.count();
+        if(fs->runs.empty()) {
+            integrate_generic(fs, begin, end, dt);
         }
-    }   
-} 
+        auto first = upper_bound(fs->runs.begin(), fs->runs.end(), begin,     // an interleaved manifest has many runs
+                                 [](int ac, const _fleet_run &r) { return ac < r.end; });
+        for(auto run = first; (run != fs->runs.end()) && (run->begin < end); ++run) {
+            int lo = max(begin, run->begin);
+            int hi = min(end, run->end);
+            if(run->builtin) {
+                company_kernels[run->company](fs->flight_time.data(), fs->miles_travelled.data(), fs->bat_cap_used.data(),
+                                             fs->battery_soc.data(), fs->status.data(), fs->bat_cap_limit.data(), lo, hi, dt);
+            } else {
+                integrate_generic(fs, lo, hi, dt);
+            }
+        }
+    }
+}
 
 /**
- * @brief Simulates aircraft behavior in a periodic loop based on SERVICE_INTERVAL
+ * @brief Steps a contiguous slice of the fleet through the aircraft state machine.
+ *        Called by the worker pool, one slice per worker.
  *
- * @param tid Thread ID for the simulation.
- * @param plane Pointer to the aircraft object.
- * @param cq Pointer to the charging queue.
+ * @param ctx Pointer to the simulation context.
+ * @param begin First aircraft of the slice.
+ * @param end One past the last aircraft of the slice.
+ * @param interval Time step for the state machine.
  *
  * @return None
  */
-void aircraft_simul(int tid, aircraft *plane, queue<_c_queue_entry*> *cq)  {
-    thread_local milliseconds interval(SERVICE_INTERVAL), ref;
-    if(plane) {
-        // TO DO: add a barrier to synchronize the start 
-        plane->set_status(IN_FLIGHT);
-        while(!global_terminate) {
-            if(isduration(ref, interval)) {
-                plane->state_machine(interval, charge_signals[plane->get_ac_num()], 
-                                     &fault_signals[plane->get_ac_num()], cq);
-                get_counter_val(&ref);
-            }
+void aircraft_simul(_sim_context *ctx, int begin, int end, milliseconds interval)  {
+    if(ctx && !ctx->terminate.load(memory_order_relaxed)) {
+        fleet_integrate_flight(&ctx->store, begin, end, interval);
+        for(int ac=begin; (ac<end) && !ctx->terminate.load(memory_order_relaxed); ac++) {
+            ctx->fleet[ac]->state_machine(interval, &ctx->mailbox[ac], &ctx->charge_queue, &ctx->live);
+        }
+    }
+}
+
+/**
+ * @brief Steps the whole fleet once every SERVICE_INTERVAL. The fleet is split in
+ *        contiguous slices across the worker pool, so the number of threads does not
+ *        grow with the fleet and the workers sleep between ticks. Every step is reported
+ *        to the timer, which measures the drift against the simulation clock.
+ *
+ * @param pool Pointer to the worker pool.
+ * @param ctx Pointer to the simulation context.
+ *
+ * @return None
+ */
+void simulation_service(worker_pool *pool, _sim_context *ctx) {
+    milliseconds interval(SERVICE_INTERVAL);
+    if(pool && ctx && timer_due(simulation_timer)) {
+        INSTR_TICK(PROBE_SIMULATION, timer_wall_time(interval));
+        INSTR_SCOPE(PROBE_SIMULATION);
+        pool->parallel_for(ctx->cfg.aircrafts, [ctx, interval](int begin, int end) {
+            aircraft_simul(ctx, begin, end, interval);
+        });
+        timer_advanced(interval);                       // fixed step, a slow host falls behind the clock
+    }
+}
+
+/**
+ * @brief Sets every aircraft airborne at the start of a wall-clock paced run.
+ *
+ * @param ctx Pointer to the simulation context.
+ *
+ * @return None
+ */
+void launch_fleet(_sim_context *ctx) {
+    if(ctx) {
+        for(auto plane: ctx->fleet) {
+            plane->set_status(IN_FLIGHT);
         }
     }
 }
@@ -85,164 +319,197 @@ void aircraft_simul(int tid, aircraft *plane, queue<_c_queue_entry*> *cq)  {
  *        Handles ongoing charging sessions, checks for completion or faults,
  *        and assigns queued aircraft to available chargers.
  *
- * @param ch Pointer to the charger manager.
- * @param cq Pointer to the aircraft charging queue.
+ * @param ctx Pointer to the simulation context.
  *
  * @return None
  */
-void charging_service(charger *ch, queue<_c_queue_entry*> *cq) {
+void charging_service(_sim_context *ctx) {
     milliseconds interval(CHARGING_INTERVAL);
-    if(ch && cq && isduration(charging_ref, interval)) {
-        if(charger1_live.status == BUSY_CHARGING) {     // update live status 
-            charger1_live.c_time_left -= interval.count();
-            if((charger1_live.c_time_left <= 0) || (fault_signals[charger1_live.ac_num]==2)) {        // check if done charging   
-                charge_signals[charger1_live.ac_num] = 0;
-                //cout << "Charging done for: " << charger1_live.ac_num << endl;
-                charger1_live.status = READY_TO_CHARGE;
-                charger1_live.ac_num = -1;
-                charger1_live.c_time_left = 0;
-                ch->update_charger_stat(CHARGER_1, READY_TO_CHARGE);
-            } else {
-                ch->update_usetime(CHARGER_1, interval);    // update use time for charger 1
-            }
-        }
-        if(charger2_live.status == BUSY_CHARGING) {     // update live status
-            charger2_live.c_time_left -= interval.count();
-            if((charger2_live.c_time_left <= 0) || (fault_signals[charger2_live.ac_num]==2)) {        // check if done charging   
-                charge_signals[charger2_live.ac_num] = 0;
-                //cout << "Charging done for: " << charger2_live.ac_num << endl;
-                charger2_live.status = READY_TO_CHARGE;
-                charger2_live.ac_num = -1;
-                charger2_live.c_time_left = 0;
-                ch->update_charger_stat(CHARGER_2, READY_TO_CHARGE);
-            } else {
-                ch->update_usetime(CHARGER_2, interval);    // update use time for charger 2
-            }
-        }
-        if(charger3_live.status == BUSY_CHARGING) {     // update live status
-            charger3_live.c_time_left -= interval.count();
-            if((charger3_live.c_time_left <= 0) || (fault_signals[charger3_live.ac_num]==2)) {        // check if done charging   
-                charge_signals[charger3_live.ac_num] = 0;
-                //cout << "Charging done for: " << charger3_live.ac_num << endl;
-                charger3_live.status = READY_TO_CHARGE;
-                charger3_live.ac_num = -1;
-                charger3_live.c_time_left = 0;
-                ch->update_charger_stat(CHARGER_3, READY_TO_CHARGE);
-            } else {
-                ch->update_usetime(CHARGER_3, interval);    // update use time for charger 3
-            }
-        }
-
-        if(!cq->empty()) {                              // check if any aircrafts in queue
-            if(charger1_live.status == READY_TO_CHARGE) {     
-                _c_queue_entry *entry = cq->front();
-                charger1_live.ac_num = entry->ac_num;
-                charger1_live.c_time_left = entry->charge_time;
-                charger1_live.status = BUSY_CHARGING;
-                cq->pop();
-                charge_signals[charger1_live.ac_num] = CHARGER_1;
-                ch->update_charger_stat(CHARGER_1, BUSY_CHARGING);
-                //cout << "Charging started for: " << charger1_live.ac_num << " on charger: 1"<< endl; 
-            } else if(charger2_live.status == READY_TO_CHARGE) {     
-                _c_queue_entry *entry = cq->front();
-                charger2_live.ac_num = entry->ac_num;
-                charger2_live.c_time_left = entry->charge_time;
-                charger2_live.status = BUSY_CHARGING;
-                cq->pop();
-                charge_signals[charger2_live.ac_num] = CHARGER_2;
-                ch->update_charger_stat(CHARGER_2, BUSY_CHARGING);
-                //cout << "Charging started for: " << charger2_live.ac_num << " on charger: 2"<<  endl; 
-            } else if(charger3_live.status == READY_TO_CHARGE) {     
-                _c_queue_entry *entry = cq->front();
-                charger3_live.ac_num = entry->ac_num;
-                charger3_live.c_time_left = entry->charge_time;
-                charger3_live.status = BUSY_CHARGING;
-                cq->pop();
-                charge_signals[charger3_live.ac_num] = CHARGER_3;
-                ch->update_charger_stat(CHARGER_3, BUSY_CHARGING);
-                //cout << "Charging started for: " << charger3_live.ac_num << " on charger: 3"<<  endl;
-            }
-        } 
-        get_counter_val(&charging_ref);
+    if(ctx && timer_due(charging_timer)) {
+        INSTR_TICK(PROBE_CHARGING, timer_wall_time(interval));
+        charging_update(ctx, interval, nullptr);
     }
 }
 
 /**
- * @brief Sets the fault signal state for a given aircraft.
+ * @brief Charge queue message taken in one charging step.
  *
- * @param ac Aircraft index.
- * @param state Fault state to set.
+ * @var key Aircraft number in the high half, drain order in the low half.
+ * @var entry Message.
+ */
+typedef struct C_DRAINED_ENTRY {
+    long key;
+    _c_queue_entry entry;
+} _c_drained_entry;
+
+/**
+ * @brief Frees a charger and clears the charge signal of the aircraft that was on it.
+ *        The signal is only cleared if it still points at this charger, a late release
+ *        must not end a newer session of the same aircraft.
+ *
+ * @param ctx Pointer to the simulation context.
+ * @param pool Pointer to the charger pool.
+ * @param id Charger to release.
+ * @param changed Optional list of aircraft whose charge signal changed.
  *
  * @return None
  */
-void set_fault_sig(int ac, int state) {
-    if(ac<TOTAL_AIRCRAFTS) {
-        fault_signals[ac] = state;
+static void release_charger(_sim_context *ctx, charger *pool, _charger_id id, vector<int> *changed) {
+    int ac = pool->release(id);
+    if(ac >= 0) {
+        int expected = id;
+        ctx->mailbox[ac].charge.compare_exchange_strong(expected, 0, memory_order_acq_rel);
+        if(changed) { changed->push_back(ac); }
     }
 }
 
 /**
- * @brief Gets the fault signal state for a given aircraft.
+ * @brief Single step of the charging service. Advances the charger pool by the elapsed
+ *        time, takes all pending messages from the charge queue, releases finished or
+ *        faulted sessions, drops the requests of aircraft that faulted while queued and
+ *        assigns waiting aircraft to every free charger.
+ *        Used by the periodic charging service and by the event engine.
  *
- * @param ac Aircraft index (1-based).
+ * @param ctx Pointer to the simulation context.
+ * @param elapsed Time elapsed since the last update.
+ * @param changed Optional list filled with aircraft whose charge signal changed.
  *
- * @return Fault state of the aircraft.
+ * @return Number of aircraft assigned to a charger in this step.
  */
-int get_fault_sig(int ac) {
-    int ret=0;
-    if(ac<=TOTAL_AIRCRAFTS) {
-        ret = fault_signals[ac-1];
+int charging_update(_sim_context *ctx, milliseconds elapsed, vector<int> *changed) {
+    return ctx ? charging_update_pool(ctx, &ctx->chargers, &ctx->charge_queue, elapsed, changed) : 0;
+}
+
+/**
+ * @brief Charging step of one charger pool and its charge queue, e.g. of a vertiport in
+ *        the network model. Same as charging_update(), the signals go to the context mailboxes.
+ *
+ * @param ctx Pointer to the simulation context.
+ * @param pool Pointer to the charger pool.
+ * @param cq Pointer to the charge queue of the pool.
+ * @param elapsed Time elapsed since the last update.
+ * @param changed Optional list filled with aircraft whose charge signal changed.
+ *
+ * @return Number of aircraft assigned to a charger in this step.
+ */
+int charging_update_pool(_sim_context *ctx, charger *pool, mpsc_queue<_c_queue_entry> *cq, milliseconds elapsed, vector<int> *changed) {
+    int assigned = 0;
+    if(ctx && pool && cq) {
+        INSTR_SCOPE(PROBE_CHARGING);
+        pool->advance(elapsed);
+
+        // The fleet workers push in whatever order the threads run, so the step's messages
+        // are taken by aircraft number first, push order per aircraft. The waiting order
+        // then does not depend on thread timing or on the number of workers.
+        static thread_local vector<_c_drained_entry> inbox;
+        _c_queue_entry entry;
+        int drained = 0;
+        inbox.clear();
+        while(cq->pop(entry)) {
+            inbox.push_back({((long)entry.ac_num << 32) | drained, entry});
+            drained++;
+        }
+        sort(inbox.begin(), inbox.end(), [](const _c_drained_entry &a, const _c_drained_entry &b) { return a.key < b.key; });
+        for(auto &in: inbox) {
+            entry = in.entry;
+            if(entry.msg == CHARGER_RELEASE) {
+                _c_live_info live = pool->get_live(entry.c_id);
+                if((live.status == BUSY_CHARGING) && (live.ac_num == entry.ac_num)) {
+                    release_charger(ctx, pool, entry.c_id, changed);    // released after a fault
+                }
+            } else if(entry.msg == CHARGE_CANCEL) {
+                if(pool->cancel(entry.ac_num, ctx->mailbox[entry.ac_num].charge.load(memory_order_acquire)) > 0) {    // faulted while queued, maybe already assigned
+                    ctx->mailbox[entry.ac_num].charge.store(0, memory_order_release);
+                    if(changed) { changed->push_back(entry.ac_num); }
+                }
+            } else {
+                pool->enqueue(entry);
+            }
+        }
+
+        _charger_id id;
+        while(pool->pop_finished(&id)) {                // check if done charging
+            release_charger(ctx, pool, id, changed);
+        }
+
+        while(pool->assign_next(&id, &entry)) {
+            ctx->mailbox[entry.ac_num].charge.store(id, memory_order_release);
+            if(changed) { changed->push_back(entry.ac_num); }
+            assigned++;
+        }
+        INSTR_GAUGE(GAUGE_CHARGE_QUEUE, drained);
+        INSTR_GAUGE(GAUGE_CHARGE_WAITING, pool->waiting_count());
+    }
+    return assigned;
+}
+
+/**
+ * @brief Gets the live status of a charger.
+ *
+ * @param ctx Pointer to the simulation context.
+ * @param id Charger id.
+ *
+ * @return Live charger info. Status OUT_OF_SERVICE for unknown ids.
+ */
+_c_live_info get_charger_live(_sim_context *ctx, _charger_id id) {
+    _c_live_info ret = {OUT_OF_SERVICE, -1, 0};
+    if(ctx) {
+        ret = ctx->chargers.get_live(id);
     }
     return ret;
 }
 
 /**
- * @brief Sets the global termination signal.
+ * @brief Posts a fault to the mailbox of an aircraft.
  *
- * @param state Termination flag value.
+ * @param ctx Pointer to the simulation context.
+ * @param ac Aircraft index.
  *
  * @return None
  */
-void set_terminate_sig(bool state) {
-    global_terminate = state;
+void post_fault(_sim_context *ctx, int ac) {
+    if(ctx && (ac>=0) && (ac<ctx->cfg.aircrafts)) {
+        ctx->mailbox[ac].faults.fetch_add(1, memory_order_release);
+    }
 }
 
 /**
- * @brief Sets the charge signal state for a given aircraft.
+ * @brief Sets the global termination signal.
  *
- * @param ac Aircraft index (1-based).
- * @param state Charge state to set.
+ * @param ctx Pointer to the simulation context.
+ * @param state Termination flag value.
  *
  * @return None
  */
-int get_fault_sig() {
-    return global_terminate;
+void set_terminate_sig(_sim_context *ctx, bool state) {
+    if(ctx) {
+        ctx->terminate.store(state, memory_order_release);
+    }
 }
 
 /**
- * @brief Gets the charge signal state for a given aircraft.
+ * @brief Gets the global termination signal.
  *
- * @param ac Aircraft index (1-based).
+ * @param ctx Pointer to the simulation context.
  *
- * @return Charge state of the aircraft.
+ * @return Termination flag value.
  */
-void set_charge_sig(int ac, int state) {
-    if(ac<=TOTAL_AIRCRAFTS) {
-        charge_signals[ac-1] = state;
-    }
+int get_terminate_sig(_sim_context *ctx) {
+    return (ctx) ? ctx->terminate.load(memory_order_acquire) : true;
 }
 
 /**
- * @brief Gets the charge signal state for a given aircraft.
+ * @brief Gets the charger an aircraft is assigned to.
  *
- * @param ac Aircraft index (1-based).
+ * @param ctx Pointer to the simulation context.
+ * @param ac Aircraft index.
  *
- * @return Charge state of the aircraft.
+ * @return Charger id, 0 when not charging.
  */
-int get_charge_sig(int ac) {
+int get_charge_sig(_sim_context *ctx, int ac) {
     int ret=0;
-    if(ac<=TOTAL_AIRCRAFTS) {
-        ret = charge_signals[ac-1];
+    if(ctx && (ac>=0) && (ac<ctx->cfg.aircrafts)) {
+        ret = ctx->mailbox[ac].charge.load(memory_order_acquire);
     }
     return ret;
 }
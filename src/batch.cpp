@@ -0,0 +1,270 @@
+/**
+ * @brief   Batch Runner file
+ * @details This file contains the Monte Carlo batch runner for the eVtol simulation problem from Joby Avation.
+ *          Every replication runs in a simulation context owned by its worker thread, on the event engine,
+ *          with its own seed derived from the master seed. Replications are pulled by the worker pool threads
+ *          one at a time and their results stream into an online aggregator (mean, variance, percentiles).
+ *          Jobs can also be what-if branches forked from a checkpoint held in memory, so the warm-up is
+ *          simulated once for all of them.
+ *
+ * @author  Deepak E Kapure
+ * @date    07-02-2025
+ *
+ */
+
+#include "../includes/batch.hpp"
+#include "../includes/event_engine.hpp"
+#include "../includes/checkpoint.hpp"
+#include "../includes/network.hpp"
+#include "../includes/worker_pool.hpp"
+#include "../includes/philox.hpp"
+#include <iomanip>
+
+static const double batch_quantiles[BATCH_QUANTILES] = {0.05, 0.5, 0.95};
+static const char *metric_names[TOTAL_METRICS] = {
+    "Number_of_Flights",
+    "Avg_flight_time(hrs)",
+    "Avg_distance_per_flight(mile)",
+    "Average_charge_time(hrs)",
+    "Total_faults",
+    "Total_passenger_miles(miles)"
+};
+
+/**
+ * @brief Aggregator shared by the batch workers. Results are added in job order, results
+ *        that finish early wait in pending, so the summary does not depend on the number
+ *        of threads or on scheduling.
+ *
+ * @var lock Protects the members below.
+ * @var pending Finished jobs not yet aggregated, by job number.
+ * @var next Next job to aggregate.
+ * @var reps Replications per point, job j is replication j % reps of point j / reps.
+ * @var res Aggregated results per point.
+ */
+typedef struct BATCH_AGGREGATOR {
+    mutex lock;
+    map<int, _sim_metrics> pending;
+    int next;
+    int reps;
+    vector<_batch_result> *res;
+} _batch_aggregator;
+
+/**
+ * @brief Derives the seed of a replication from the master seed.
+ *
+ * @param master Master seed.
+ * @param replication Replication number.
+ *
+ * @return Replication seed.
+ */
+uint64_t replication_seed(uint64_t master, int replication) {
+    philox_rng rng(master, RNG_STREAM_REPLICATION + (uint64_t)replication);
+    uint64_t hi = rng.next_u32();
+    return (hi << 32) | rng.next_u32();
+}
+
+/**
+ * @brief Runs one replication on the event engine, without input logs or flight data
+ *        recording. The context is reinitialized, so a worker can reuse one context and
+ *        its allocations for all of its replications. With cfg.sites set the replication
+ *        runs on the vertiport network.
+ *
+ * @param ctx Pointer to the simulation context to run in.
+ * @param cfg Configuration of the replication, including its seed.
+ * @param map Pointer to aircraft configuration map.
+ * @param pmap Pointer to the failure probability map by aircraft company.
+ * @param m Filled with the results.
+ *
+ * @return None
+ */
+void run_replication(_sim_context *ctx, const _sim_config &cfg, _ac_map *map, _prob_map *pmap, _sim_metrics *m) {
+    init_sim_context(ctx, cfg);
+    ctx->cfg.log_inputs = false;
+    ctx->cfg.realtime = false;
+    ctx->cfg.checkpoint_hours = 0;
+    create_aircrafts(ctx, map, TOTAL_CATEGORIES);
+    fault_injection(pmap, ctx);
+    milliseconds end_time((long)(ctx->cfg.sim_hours * SIMULATION_FACTOR));
+    if(ctx->cfg.sites > 0) {
+        _network net;                                   // sites on the replication thread, the batch is parallel already
+        network_simulation(ctx, &net, end_time, nullptr);
+    } else {
+        des_simulation(ctx, end_time);
+    }
+    compute_sim_metrics(ctx, m);
+    delete_aircrafts(ctx);
+}
+
+/**
+ * @brief Runs one what-if branch from a checkpoint on the event engine. The context is
+ *        restored from the checkpoint bytes, which are shared by all branches and not
+ *        modified, then continued with the branch settings.
+ *
+ * @param ctx Pointer to the simulation context to run in.
+ * @param ckpt Checkpoint bytes.
+ * @param cfg Settings of the branch, including its seed.
+ * @param m Filled with the results, all 0 if the checkpoint is damaged.
+ *
+ * @return None
+ */
+void run_branch(_sim_context *ctx, const vector<char> &ckpt, const _sim_config &cfg, _sim_metrics *m) {
+    _sim_config run = cfg;
+    run.log_inputs = false;
+    run.realtime = false;
+    run.checkpoint_hours = 0;
+    ckpt_reader in(ckpt.data(), ckpt.size());
+    milliseconds now, end_time;
+    *m = _sim_metrics();
+    if(restore_sim_context(ctx, &in, run, &now, &end_time) && des_resume(ctx, &in, now, end_time, &run)) {
+        compute_sim_metrics(ctx, m);
+    }
+    delete_aircrafts(ctx);
+}
+
+/**
+ * @brief Resets an aggregated result.
+ *
+ * @param res Pointer to the result.
+ *
+ * @return None
+ */
+static void reset_batch_result(_batch_result *res) {
+    res->replications = 0;
+    res->seconds = 0;
+    for(auto &company: res->series) {
+        for(auto &s: company) {
+            s.stats = running_stats();
+            for(int q=0; q<BATCH_QUANTILES; q++) {
+                s.quantile[q] = p2_quantile(batch_quantiles[q]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Adds a finished job to the aggregator, together with every pending one that is
+ *        now next in order.
+ *
+ * @param agg Pointer to the aggregator.
+ * @param job Job number.
+ * @param m Results of the job.
+ *
+ * @return None
+ */
+static void aggregate(_batch_aggregator *agg, int job, const _sim_metrics &m) {
+    lock_guard<mutex> guard(agg->lock);
+    agg->pending[job] = m;
+    while(!agg->pending.empty() && (agg->pending.begin()->first == agg->next)) {
+        const _sim_metrics &cur = agg->pending.begin()->second;
+        _batch_result *res = &(*agg->res)[agg->next / agg->reps];
+        for(int c=0; c<TOTAL_CATEGORIES; c++) {
+            for(int k=0; k<TOTAL_METRICS; k++) {
+                _batch_series *s = &res->series[c][k];
+                s->stats.add(cur.value[c][k]);
+                for(int q=0; q<BATCH_QUANTILES; q++) {
+                    s->quantile[q].add(cur.value[c][k]);
+                }
+            }
+        }
+        agg->pending.erase(agg->pending.begin());
+        agg->next++;
+        res->replications++;
+    }
+}
+
+/**
+ * @brief Runs reps replications of every configuration point across the worker pool.
+ *        Each worker keeps one simulation context for all of its jobs and pulls the next
+ *        job number until all are done, so threads stay busy even if jobs take different
+ *        times. Replication r of every point uses the same seed, points are compared on
+ *        the same random draws.
+ *
+ * @param points Configurations to run. points[0].seed is the master seed, points[0].workers the thread count.
+ * @param reps Replications per point.
+ * @param map Pointer to aircraft configuration map.
+ * @param pmap Pointer to the failure probability map by aircraft company.
+ * @param res Filled with the aggregated results, one per point.
+ * @param branch_from Checkpoint to fork every job from as a what-if branch, nullptr to run from the start.
+ *
+ * @return None
+ */
+void run_batch_points(const vector<_sim_config> &points, int reps, _ac_map *map, _prob_map *pmap, vector<_batch_result> *res,
+                      const vector<char> *branch_from) {
+    res->resize(points.size());
+    for(auto &r: *res) {
+        reset_batch_result(&r);
+    }
+    if(points.empty() || (reps < 1)) {
+        return;
+    }
+    _batch_aggregator agg;
+    agg.next = 0;
+    agg.reps = reps;
+    agg.res = res;
+    atomic<int> issued(0);
+    int total = (int)points.size() * reps;
+    uint64_t master = points[0].seed;
+
+    auto start = steady_clock::now();
+    worker_pool pool(min(points[0].workers, total));
+    pool.parallel_for(pool.size(), [&](int, int) {
+        _sim_context ctx;                               // one context per worker, reused for every job
+        int job;
+        while((job = issued.fetch_add(1, memory_order_relaxed)) < total) {
+            _sim_config cfg = points[job / reps];
+            cfg.seed = replication_seed(master, job % reps);
+            _sim_metrics m;
+            if(branch_from) {
+                run_branch(&ctx, *branch_from, cfg, &m);
+            } else {
+                run_replication(&ctx, cfg, map, pmap, &m);
+            }
+            aggregate(&agg, job, m);
+        }
+    });
+    double seconds = duration<double>(steady_clock::now() - start).count();
+    for(auto &r: *res) {
+        r.seconds = seconds;
+    }
+}
+
+/**
+ * @brief Runs cfg.replications independent replications across the worker pool.
+ *
+ * @param cfg Base configuration, cfg.seed is the master seed and cfg.workers the thread count.
+ * @param map Pointer to aircraft configuration map.
+ * @param pmap Pointer to the failure probability map by aircraft company.
+ * @param res Filled with the aggregated results.
+ *
+ * @return None
+ */
+void run_batch(const _sim_config &cfg, _ac_map *map, _prob_map *pmap, _batch_result *res) {
+    vector<_batch_result> all;
+    run_batch_points(vector<_sim_config>(1, cfg), cfg.replications, map, pmap, &all, nullptr);
+    *res = all[0];
+}
+
+/**
+ * @brief Writes the batch summary, one line per company and metric.
+ *
+ * @param res Pointer to the aggregated results.
+ * @param out Output stream.
+ *
+ * @return None
+ */
+void write_batch_results(_batch_result *res, ostream &out) {
+    out << "Batch_Results: " << res->replications << " replications, " << res->seconds << " s, "
+        << ((res->seconds > 0) ? (res->replications / res->seconds) : 0.0) << " replications/s\n";
+    out << "Company Metric Mean Stddev CI95 P5 P50 P95 Min Max\n";
+    for(int c=0; c<TOTAL_CATEGORIES; c++) {
+        for(int k=0; k<TOTAL_METRICS; k++) {
+            _batch_series *s = &res->series[c][k];
+            out << company_name(c) << " " << metric_names[k] << " " << s->stats.mean() << " "
+                << s->stats.stddev() << " " << s->stats.ci95();
+            for(int q=0; q<BATCH_QUANTILES; q++) {
+                out << " " << s->quantile[q].value();
+            }
+            out << " " << s->stats.min_value() << " " << s->stats.max_value() << "\n";
+        }
+    }
+}
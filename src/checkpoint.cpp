@@ -0,0 +1,391 @@
+/**
+ * @brief   Checkpoint file
+ * @details This file contains the checkpoint and restore of the simulation state for the eVtol simulation problem
+ *          from Joby Avation. A checkpoint holds everything a run on the event engine depends on: the fleet
+ *          store, the aircraft transition state, the charger pool, pending charge messages, the fault schedule
+ *          with the random stream of every aircraft and the live statistics. The event engine appends its own
+ *          queue. A restored run continues bit exactly, or forks into what-if branches that change chargers,
+ *          fault rate, downtime, soc threshold or seed from the checkpoint on.
+ *
+ * @author  Deepak E Kapure
+ * @date    07-02-2025
+ *
+ */
+
+#include "../includes/checkpoint.hpp"
+#include "../includes/philox.hpp"
+#include <cstring>
+#include <cstdio>
+
+/**
+ * @brief Simulation settings saved with a checkpoint. Run options such as the engine,
+ *        threads or recorder format are taken from the command line of the restored run.
+ */
+typedef struct CKPT_CONFIG {
+    int32_t aircrafts;
+    int32_t chargers;
+    int32_t policy;
+    int32_t soc_threshold;
+    int32_t fdr_interval;
+    int32_t mix[TOTAL_CATEGORIES];
+    uint64_t seed;
+    double sim_hours;
+    double charger_power;
+    double fault_scale;
+    double downtime_hours;
+} _ckpt_config;
+
+/**
+ * @brief Company specification saved with a checkpoint.
+ */
+typedef struct CKPT_SPEC {
+    int32_t speed;
+    int32_t batt_cap;
+    int32_t toc_hrs;
+    int32_t energy_use;
+    int32_t passengers;
+    double fault_prob;
+} _ckpt_spec;
+
+// Checkpoint a company specification field by field, the padding before fault_prob is never written
+static void put_record(ckpt_writer *w, const _ckpt_spec &cs) {
+    w->put(cs.speed);
+    w->put(cs.batt_cap);
+    w->put(cs.toc_hrs);
+    w->put(cs.energy_use);
+    w->put(cs.passengers);
+    w->put(cs.fault_prob);
+}
+static bool get_record(ckpt_reader *r, _ckpt_spec *cs) {
+    r->get(&cs->speed);
+    r->get(&cs->batt_cap);
+    r->get(&cs->toc_hrs);
+    r->get(&cs->energy_use);
+    r->get(&cs->passengers);
+    return r->get(&cs->fault_prob);
+}
+
+/**
+ * @brief Copies the saved simulation settings into a configuration.
+ *
+ * @param cc Saved settings.
+ * @param cfg Pointer to the configuration.
+ *
+ * @return None
+ */
+static void apply_ckpt_config(const _ckpt_config &cc, _sim_config *cfg) {
+    cfg->aircrafts = cc.aircrafts;
+    cfg->chargers = cc.chargers;
+    cfg->policy = (_dispatch_policy)cc.policy;
+    cfg->soc_threshold = cc.soc_threshold;
+    cfg->fdr_interval = cc.fdr_interval;
+    for(int c=0; c<TOTAL_CATEGORIES; c++) {
+        cfg->mix[c] = cc.mix[c];
+    }
+    cfg->seed = cc.seed;
+    cfg->sim_hours = cc.sim_hours;
+    cfg->charger_power = cc.charger_power;
+    cfg->fault_scale = cc.fault_scale;
+    cfg->downtime_hours = cc.downtime_hours;
+    cfg->manifest = nullptr;
+}
+
+/**
+ * @brief Reads and checks the header and saved settings of a checkpoint.
+ *
+ * @param r Pointer to the reader, at the start of the checkpoint.
+ * @param hdr Filled with the header.
+ * @param cc Filled with the saved settings.
+ *
+ * @return False if this is not a checkpoint of this version.
+ */
+static bool read_ckpt_head(ckpt_reader *r, _ckpt_header *hdr, _ckpt_config *cc) {
+    size_t total = r->remaining();
+    return r->get(hdr) && (memcmp(hdr->magic, CKPT_MAGIC, CKPT_MAGIC_LEN) == 0) && (hdr->version == CKPT_VERSION) &&
+           (hdr->bytes == total) && r->get(cc) && (cc->aircrafts >= 1) && (hdr->aircrafts == (uint32_t)cc->aircrafts) &&
+           (cc->chargers >= 1) && (hdr->time >= 0) && (hdr->time <= hdr->end_time) && (cc->fdr_interval >= 1);
+}
+
+/**
+ * @brief Writes the header and the whole simulation context to a checkpoint. Must be
+ *        called between engine steps, the charge queue is emptied and refilled in order.
+ *
+ * @param ctx Pointer to the simulation context.
+ * @param now Simulation time of the snapshot.
+ * @param end_time Simulation time at which the run ends.
+ * @param w Pointer to the writer, the event engine appends its state after the context.
+ *
+ * @return None
+ */
+void save_sim_context(_sim_context *ctx, milliseconds now, milliseconds end_time, ckpt_writer *w) {
+    int size = ctx->cfg.aircrafts;
+    _ckpt_header hdr = {};
+    memcpy(hdr.magic, CKPT_MAGIC, CKPT_MAGIC_LEN);
+    hdr.version = CKPT_VERSION;
+    hdr.aircrafts = size;
+    hdr.time = now.count();
+    hdr.end_time = end_time.count();
+    w->put(hdr);
+
+    _ckpt_config cc = {};
+    cc.aircrafts = size;
+    cc.chargers = ctx->cfg.chargers;
+    cc.policy = ctx->cfg.policy;
+    cc.soc_threshold = ctx->cfg.soc_threshold;
+    cc.fdr_interval = ctx->cfg.fdr_interval;
+    for(int c=0; c<TOTAL_CATEGORIES; c++) {
+        cc.mix[c] = ctx->cfg.mix[c];
+    }
+    cc.seed = ctx->cfg.seed;
+    cc.sim_hours = ctx->cfg.sim_hours;
+    cc.charger_power = ctx->cfg.charger_power;
+    cc.fault_scale = ctx->cfg.fault_scale;
+    cc.downtime_hours = ctx->cfg.downtime_hours;
+    w->put(cc);
+
+    _fleet_store *fs = &ctx->store;
+    for(int c=0; c<TOTAL_CATEGORIES; c++) {
+        const _ac_spec &sp = fs->spec[c];
+        _ckpt_spec cs = {sp.speed, sp.batt_cap, sp.toc_hrs, sp.energy_use, sp.passengers, sp.fault_prob};
+        put_record(w, cs);
+    }
+    w->put_vector(fs->company);
+    w->put_vector(fs->flight_time);
+    w->put_vector(fs->miles_travelled);
+    w->put_vector(fs->bat_cap_used);
+    w->put_vector(fs->battery_soc);
+    w->put_vector(fs->status);
+    w->put_vector(fs->bat_cap_limit);
+    for(auto plane: ctx->fleet) {
+        plane->save(w);
+    }
+    for(auto &mb: ctx->mailbox) {
+        w->put<int32_t>(mb.faults.load(memory_order_acquire));
+        w->put<int32_t>(mb.charge.load(memory_order_acquire));
+    }
+    ctx->chargers.save(w);
+
+    vector<_c_queue_entry> pending;
+    _c_queue_entry e;
+    while(ctx->charge_queue.pop(e)) {
+        pending.push_back(e);
+    }
+    for(auto &p: pending) {
+        ctx->charge_queue.push(p);
+    }
+    w->put_vector(pending);
+    ctx->faults.save(w);
+    ctx->live.save(w);
+}
+
+/**
+ * @brief Completes a checkpoint once every part is written, sets its size in the header.
+ *
+ * @param w Pointer to the writer.
+ *
+ * @return None
+ */
+void finish_checkpoint(ckpt_writer *w) {
+    w->put_at<uint64_t>(offsetof(_ckpt_header, bytes), (uint64_t)w->size());
+}
+
+/**
+ * @brief Rebuilds a simulation context from a checkpoint: creates the fleet with the saved
+ *        companies and specifications, then loads the state on top of it. The event engine
+ *        state that follows is read by des_resume().
+ *
+ * @param ctx Pointer to the simulation context, initialized here.
+ * @param r Pointer to the reader, at the start of the checkpoint.
+ * @param run Configuration of the restored run. Only run options are used (engine, threads,
+ *            recorder format, logs), the simulation settings come from the checkpoint.
+ * @param now Filled with the simulation time of the snapshot.
+ * @param end_time Filled with the simulation time at which the run ends.
+ *
+ * @return False if the checkpoint is damaged.
+ */
+bool restore_sim_context(_sim_context *ctx, ckpt_reader *r, const _sim_config &run, milliseconds *now, milliseconds *end_time) {
+    _ckpt_header hdr;
+    _ckpt_config cc;
+    if(!ctx || !read_ckpt_head(r, &hdr, &cc)) {
+        return false;
+    }
+    _sim_config cfg = run;
+    apply_ckpt_config(cc, &cfg);
+
+    _ac_map map;
+    double fault_prob[TOTAL_CATEGORIES];
+    for(int c=0; c<TOTAL_CATEGORIES; c++) {
+        _ckpt_spec cs = {};
+        get_record(r, &cs);
+        map[(_ac_type)c] = {cs.speed, cs.batt_cap, cs.toc_hrs, cs.energy_use, cs.passengers};
+        fault_prob[c] = cs.fault_prob;
+    }
+    vector<uint8_t> company;
+    bool ok = r->get_vector(&company) && (company.size() == (size_t)cc.aircrafts);
+    for(size_t ac=0; ok && (ac<company.size()); ac++) {
+        ok = (company[ac] < TOTAL_CATEGORIES);
+    }
+    if(!ok) {
+        return false;
+    }
+    cfg.manifest = &company;                            // same aircraft numbers as the saved run
+    init_sim_context(ctx, cfg);
+    create_aircrafts(ctx, &map, TOTAL_CATEGORIES);
+    ctx->cfg.manifest = nullptr;
+
+    int size = ctx->cfg.aircrafts;
+    _fleet_store *fs = &ctx->store;
+    for(int c=0; c<TOTAL_CATEGORIES; c++) {
+        fs->spec[c].fault_prob = fault_prob[c];
+    }
+    r->get_vector(&fs->flight_time);
+    r->get_vector(&fs->miles_travelled);
+    r->get_vector(&fs->bat_cap_used);
+    r->get_vector(&fs->battery_soc);
+    r->get_vector(&fs->status);
+    r->get_vector(&fs->bat_cap_limit);
+    ok = r->good() && (fs->flight_time.size() == (size_t)size) && (fs->miles_travelled.size() == (size_t)size) &&
+         (fs->bat_cap_used.size() == (size_t)size) && (fs->battery_soc.size() == (size_t)size) &&
+         (fs->status.size() == (size_t)size) && (fs->bat_cap_limit.size() == (size_t)size);
+    for(int ac=0; ok && (ac<size); ac++) {
+        ok = ctx->fleet[ac]->load(r);
+    }
+    for(int ac=0; ok && (ac<size); ac++) {
+        int32_t faults = 0, charge = 0;
+        r->get(&faults);
+        ok = r->get(&charge);
+        ctx->mailbox[ac].faults.store(faults, memory_order_relaxed);
+        ctx->mailbox[ac].charge.store(charge, memory_order_relaxed);
+    }
+    ok = ok && ctx->chargers.load(r);
+    vector<_c_queue_entry> pending;
+    ok = ok && r->get_vector(&pending);
+    for(size_t k=0; ok && (k<pending.size()); k++) {
+        ok = (pending[k].ac_num >= 0) && (pending[k].ac_num < size) && ctx->charge_queue.push(pending[k]);
+    }
+    ok = ok && ctx->faults.load(r, size) && ctx->live.load(r);
+    *now = milliseconds(hdr.time);
+    *end_time = milliseconds(hdr.end_time);
+    return ok;
+}
+
+/**
+ * @brief Reads the simulation settings of a checkpoint into a configuration, so options
+ *        given after it on the command line can change them for a what-if branch.
+ *
+ * @param ckpt Checkpoint bytes.
+ * @param cfg Pointer to the configuration.
+ * @param now Filled with the simulation time of the snapshot.
+ * @param err Filled with the reason if the checkpoint is invalid.
+ *
+ * @return False if this is not a valid checkpoint.
+ */
+bool read_checkpoint_config(const vector<char> &ckpt, _sim_config *cfg, milliseconds *now, string *err) {
+    ckpt_reader r(ckpt.data(), ckpt.size());
+    _ckpt_header hdr;
+    _ckpt_config cc;
+    if(!read_ckpt_head(&r, &hdr, &cc)) {
+        *err = "not a checkpoint of this version or truncated";
+        return false;
+    }
+    apply_ckpt_config(cc, cfg);
+    *now = milliseconds(hdr.time);
+    return true;
+}
+
+/**
+ * @brief Checks if a configuration changes any setting a what-if branch can change.
+ *
+ * @param saved Settings of the checkpoint.
+ * @param cfg Settings of the restored run.
+ *
+ * @return True if the restored run is a what-if branch rather than a continuation.
+ */
+bool is_what_if(const _sim_config &saved, const _sim_config &cfg) {
+    return (saved.chargers != cfg.chargers) || (saved.fault_scale != cfg.fault_scale) ||
+           (saved.downtime_hours != cfg.downtime_hours) || (saved.soc_threshold != cfg.soc_threshold) ||
+           (saved.seed != cfg.seed);
+}
+
+/**
+ * @brief Applies the settings of a what-if branch to a restored context. Every aircraft
+ *        must already be advanced to now. The charger pool is resized, the downtime and
+ *        soc limits are set and the fault process of every aircraft restarts at now on
+ *        the branch seed and fault scale. Faults are memoryless, so redrawing them from
+ *        now gives the same distribution as the uninterrupted run.
+ *
+ * @param ctx Pointer to the restored simulation context.
+ * @param branch Settings of the branch.
+ * @param now Simulation time of the snapshot.
+ *
+ * @return None
+ */
+void apply_what_if(_sim_context *ctx, const _sim_config &branch, milliseconds now) {
+    ctx->cfg.chargers = max(1, branch.chargers);
+    ctx->cfg.fault_scale = branch.fault_scale;
+    ctx->cfg.downtime_hours = branch.downtime_hours;
+    ctx->cfg.soc_threshold = branch.soc_threshold;
+    ctx->cfg.seed = branch.seed;
+    ctx->chargers.resize(ctx->cfg.chargers);
+
+    int size = ctx->cfg.aircrafts;
+    fault_schedule *q = &ctx->faults;
+    q->init(size, q->get_horizon());
+    philox_rng rng;
+    double from = now.count() / 1000.0;                 // fault minutes, 1 minute = 1000 msec
+    for(int ac=0; ac<size; ac++) {
+        aircraft *plane = ctx->fleet[ac];
+        plane->set_limits(ctx->cfg.downtime_hours * SIMULATION_FACTOR, ctx->cfg.soc_threshold, ctx->cfg.charger_power);
+        double lambda_min = (ctx->store.spec[plane->get_company()].fault_prob * ctx->cfg.fault_scale)/60.0;
+        rng.set_stream(ctx->cfg.seed, ac);
+        q->arm(ac, rng, lambda_min, from);
+    }
+}
+
+/**
+ * @brief Writes a checkpoint file. The file is written next to the target and renamed
+ *        over it, so a crash while writing leaves the previous checkpoint intact.
+ *
+ * @param path Checkpoint file.
+ * @param w Pointer to the finished checkpoint.
+ *
+ * @return True if the file was written.
+ */
+bool write_checkpoint_file(const string &path, ckpt_writer &w) {
+    string tmp = path + ".tmp";
+    ofstream out(tmp, ios::out | ios::binary | ios::trunc);
+    const vector<char> &b = w.bytes();
+    out.write(b.data(), b.size());
+    out.close();
+    bool ok = !out.fail() && (rename(tmp.c_str(), path.c_str()) == 0);
+    if(!ok) {
+        remove(tmp.c_str());
+    }
+    return ok;
+}
+
+/**
+ * @brief Reads a whole checkpoint file into memory.
+ *
+ * @param path Checkpoint file.
+ * @param out Filled with the checkpoint bytes.
+ * @param err Filled with the reason if the file can't be read.
+ *
+ * @return True if the file was read.
+ */
+bool read_checkpoint_file(const string &path, vector<char> *out, string *err) {
+    ifstream in(path, ios::in | ios::binary | ios::ate);
+    if(!in.is_open()) {
+        *err = path + ": cannot open";
+        return false;
+    }
+    streamsize n = in.tellg();
+    in.seekg(0);
+    out->resize(max((streamsize)0, n));
+    in.read(out->data(), out->size());
+    if(!in) {
+        *err = path + ": read failed";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,368 @@
+/**
+ * @brief   Discrete Event Engine file
+ * @details This file contains the discrete event engine for the eVtol simulation problem from Joby Avation.
+ *          Instead of pacing the services against the wall clock, the engine keeps a priority queue of
+ *          timestamped events (fault, battery depleted, charge complete, maintenance done, FDR sample)
+ *          and jumps the simulation time straight to the next event. The aircraft state machine and the
+ *          charging service are driven with the exact elapsed time between events. Between two events the
+ *          state is complete, a checkpoint taken there is resumed bit exactly or forked into what-if branches.
+ *
+ * @author  Deepak E Kapure
+ * @date    07-02-2025
+ *
+ */
+
+#include "../includes/event_engine.hpp"
+#include "../includes/instrument.hpp"
+#include <algorithm>
+#include <iostream>
+
+/**
+ * @brief State of one discrete event simulation run.
+ *
+ * @var ctx Pointer to the simulation context.
+ * @var events Pending events, min-heap ordered by _event_later.
+ * @var seq Next event sequence number.
+ * @var charger_clock Time the chargers were last advanced to.
+ * @var last_update Time each aircraft was last advanced to, in the context arena.
+ * @var epoch Per aircraft epoch, bumped on every reschedule to invalidate pending events. In the context arena.
+ * @var changed Aircraft whose charge signal changed in a charging step, reused by every step.
+ * @var end_time Simulation time at which the run ends.
+ * @var checkpoint_every Simulation time between checkpoints, 0 for none.
+ * @var next_checkpoint Simulation time of the next checkpoint.
+ */
+typedef struct DES_STATE {
+    _sim_context *ctx;
+    vector<_sim_event> events;
+    unsigned long seq;
+    milliseconds charger_clock;
+    milliseconds *last_update;
+    int *epoch;
+    vector<int> changed;
+    milliseconds end_time;
+    milliseconds checkpoint_every;
+    milliseconds next_checkpoint;
+} _des_state;
+
+/**
+ * @brief Pushes a new event to the event queue.
+ *
+ * @param s Pointer to the engine state.
+ * @param t Event time.
+ * @param type Event type.
+ * @param ac Aircraft number (-1 for global events).
+ * @param epoch Aircraft epoch (-1 for events that are always processed).
+ *
+ * @return None
+ */
+static void schedule_event(_des_state *s, milliseconds t, _event_type type, int ac, int epoch) {
+    _sim_event ev = {t, s->seq++, type, ac, epoch};
+    s->events.push_back(ev);
+    push_heap(s->events.begin(), s->events.end(), _event_later());
+}
+
+/**
+ * @brief Runs the aircraft state machine for the time elapsed since its last update.
+ *
+ * @param s Pointer to the engine state.
+ * @param ac Aircraft number.
+ * @param now Current simulation time.
+ *
+ * @return None
+ */
+static void advance_aircraft(_des_state *s, int ac, milliseconds now) {
+    milliseconds dt = now - s->last_update[ac];
+    s->last_update[ac] = now;
+    s->ctx->fleet[ac]->update_ac_stats(dt);
+    s->ctx->fleet[ac]->state_machine(dt, &s->ctx->mailbox[ac], &s->ctx->charge_queue, &s->ctx->live);
+}
+
+/**
+ * @brief Invalidates pending events of an aircraft and schedules the next one
+ *        based on its current state.
+ *
+ * @param s Pointer to the engine state.
+ * @param ac Aircraft number.
+ * @param now Current simulation time.
+ *
+ * @return None
+ */
+static void reschedule_aircraft(_des_state *s, int ac, milliseconds now) {
+    aircraft *plane = s->ctx->fleet[ac];
+    s->epoch[ac]++;
+    switch(plane->get_ac_status()) {
+        case IN_FLIGHT:
+            schedule_event(s, now + plane->time_to_soc_threshold(), EV_BATTERY_DEPLETED, ac, s->epoch[ac]);
+            break;
+        case UNDER_MAINTENANCE:
+            schedule_event(s, now + milliseconds(max(1L, (long)ceil(plane->get_downtime_limit() - plane->get_downtime()))),
+                           EV_MAINTENANCE_DONE, ac, s->epoch[ac]);
+            break;
+        case IN_CHARGE_QUEUE:                   // charger events are scheduled by the charging step
+        case CHARGING:
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Advances an aircraft to the current time and reschedules it if its state changed.
+ *
+ * @param s Pointer to the engine state.
+ * @param ac Aircraft number.
+ * @param now Current simulation time.
+ *
+ * @return True if the aircraft changed state.
+ */
+static bool step_aircraft(_des_state *s, int ac, milliseconds now) {
+    int prev = s->ctx->fleet[ac]->get_ac_status();
+    advance_aircraft(s, ac, now);
+    bool changed = (prev != s->ctx->fleet[ac]->get_ac_status());
+    if(changed) {
+        reschedule_aircraft(s, ac, now);
+    }
+    return changed;
+}
+
+/**
+ * @brief Advances the chargers to the current time, releases finished or faulted sessions
+ *        and assigns queued aircraft to every free charger.
+ *
+ * @param s Pointer to the engine state.
+ * @param now Current simulation time.
+ *
+ * @return None
+ */
+static void service_chargers(_des_state *s, milliseconds now) {
+    vector<int> &changed = s->changed;
+    changed.clear();
+    milliseconds elapsed = now - s->charger_clock;
+    s->charger_clock = now;
+    charging_update(s->ctx, elapsed, &changed);
+
+    sort(changed.begin(), changed.end());
+    changed.erase(unique(changed.begin(), changed.end()), changed.end());
+    for(auto ac: changed) {
+        step_aircraft(s, ac, now);
+        int c_id = get_charge_sig(s->ctx, ac);
+        if(c_id > 0) {                          // newly assigned, schedule end of session
+            _c_live_info live = get_charger_live(s->ctx, c_id);
+            schedule_event(s, now + milliseconds(live.c_time_left), EV_CHARGE_COMPLETE, ac, -1);
+        }
+    }
+}
+
+/**
+ * @brief Sets up the engine state of a run, per aircraft clocks and epochs in the context arena.
+ *
+ * @param s Pointer to the engine state.
+ * @param ctx Pointer to the simulation context.
+ * @param end_time Total simulation time.
+ * @param events Events to reserve room for.
+ * @param start Simulation time the run starts at, the first checkpoint is one interval later.
+ *
+ * @return None
+ */
+static void init_des_state(_des_state *s, _sim_context *ctx, milliseconds end_time, size_t events, milliseconds start) {
+    int size = ctx->cfg.aircrafts;
+    s->ctx = ctx;
+    s->events.clear();
+    s->events.reserve(events);
+    s->seq = 0;
+    s->charger_clock = milliseconds(0);
+    s->last_update = ctx->arena.alloc_array<milliseconds>(size);
+    s->epoch = ctx->arena.alloc_array<int>(size);
+    fill(s->last_update, s->last_update + size, milliseconds(0));
+    fill(s->epoch, s->epoch + size, 0);
+    s->changed.reserve(2 * (size_t)ctx->cfg.chargers + 1);
+    s->end_time = end_time;
+    bool checkpoints = (ctx->cfg.checkpoint_hours > 0) && ctx->cfg.checkpoint_file;
+    s->checkpoint_every = milliseconds(checkpoints ? max(1L, (long)(ctx->cfg.checkpoint_hours * SIMULATION_FACTOR)) : 0L);
+    s->next_checkpoint = checkpoints ? (start + s->checkpoint_every) : end_time;
+}
+
+/**
+ * @brief Writes a checkpoint of the run: the context followed by the engine state. Every
+ *        event before now has been processed, the pending ones are saved as they are.
+ *
+ * @param s Pointer to the engine state.
+ * @param now Simulation time of the checkpoint.
+ *
+ * @return None
+ */
+static void write_checkpoint(_des_state *s, milliseconds now) {
+    _sim_context *ctx = s->ctx;
+    int size = ctx->cfg.aircrafts;
+    ckpt_writer w;
+    save_sim_context(ctx, now, s->end_time, &w);
+    w.put(s->seq);
+    w.put(s->charger_clock);
+    w.put_array(s->last_update, size);
+    w.put_array(s->epoch, size);
+    w.put_records(s->events);
+    finish_checkpoint(&w);
+    if(write_checkpoint_file(ctx->cfg.checkpoint_file, w)) {
+        cout << "Checkpoint at " << now.count() * SIM_MS_TO_HOURS << " hours written to " << ctx->cfg.checkpoint_file << endl;
+    } else {
+        cout << "Warning: checkpoint at " << now.count() * SIM_MS_TO_HOURS << " hours could not be written to "
+             << ctx->cfg.checkpoint_file << endl;
+    }
+}
+
+/**
+ * @brief Processes events until the end of the run, taking a checkpoint whenever the next
+ *        event is at or past the checkpoint time.
+ *
+ * @param s Pointer to the engine state.
+ *
+ * @return None
+ */
+static void run_events(_des_state *s) {
+    _sim_context *ctx = s->ctx;
+    int size = ctx->cfg.aircrafts;
+    bool running = true;
+    while(running && !s->events.empty()) {
+        while((s->events.front().time >= s->next_checkpoint) && (s->next_checkpoint < s->end_time)) {
+            write_checkpoint(s, s->next_checkpoint);
+            s->next_checkpoint += s->checkpoint_every;
+        }
+        _sim_event ev = s->events.front();
+        pop_heap(s->events.begin(), s->events.end(), _event_later());
+        s->events.pop_back();
+        if((ev.epoch >= 0) && (ev.epoch != s->epoch[ev.ac_num])) {
+            continue;                                   // stale event
+        }
+        milliseconds now = ev.time;
+        INSTR_SCOPE(PROBE_DES_EVENT);
+        switch(ev.type) {
+            case EV_FAULT:
+                ctx->faults.dispatch_due(now, [s, ctx, now](int ac) {
+                    step_aircraft(s, ac, now);
+                    post_fault(ctx, ac);
+                    advance_aircraft(s, ac, now);
+                    reschedule_aircraft(s, ac, now);
+                });
+                if(!ctx->faults.empty()) {
+                    schedule_event(s, ctx->faults.next_time(), EV_FAULT, -1, -1);
+                }
+                break;
+            case EV_BATTERY_DEPLETED:
+            case EV_MAINTENANCE_DONE:
+                if(!step_aircraft(s, ev.ac_num, now)) {
+                    reschedule_aircraft(s, ev.ac_num, now);     // charge queue full, retry
+                }
+                break;
+            case EV_CHARGE_COMPLETE:
+                break;                                  // handled by the charging step below
+            case EV_FDR_SAMPLE:
+                if(now + milliseconds(ctx->cfg.fdr_interval) < s->end_time) {     // only the next sample is pending
+                    schedule_event(s, now + milliseconds(ctx->cfg.fdr_interval), EV_FDR_SAMPLE, -1, -1);
+                }
+                for(int ac=0; ac<size; ac++) {
+                    step_aircraft(s, ac, now);
+                }
+                record_flight_data(ctx, now);
+                break;
+            case EV_SIM_END:
+            default:
+                for(int ac=0; ac<size; ac++) {
+                    step_aircraft(s, ac, now);
+                }
+                running = false;
+                break;
+        }
+        if(running) {
+            service_chargers(s, now);
+        }
+    }
+}
+
+/**
+ * @brief Runs the simulation as a discrete event simulation. Simulation time jumps from
+ *        one event to the next, so the run time only depends on the number of events.
+ *        With cfg.checkpoint_hours set, a checkpoint is written every that many hours.
+ *
+ * @param ctx Pointer to the simulation context. Fleet, fault schedule and flight data recorder must be initialized.
+ * @param end_time Total simulation time.
+ *
+ * @return None
+ */
+void des_simulation(_sim_context *ctx, milliseconds end_time) {
+    if(!ctx) {
+        return;
+    }
+    int size = ctx->cfg.aircrafts;
+    _des_state s;
+    init_des_state(&s, ctx, end_time, 2 * (size_t)size + 3, milliseconds(0));  // one pending event per aircraft and stale ones in between
+
+    schedule_event(&s, end_time, EV_SIM_END, -1, -1);
+    if(ctx->fdr.is_running() && (milliseconds(ctx->cfg.fdr_interval) < end_time)) {   // no samples without a recorder, e.g. batch replications
+        schedule_event(&s, milliseconds(ctx->cfg.fdr_interval), EV_FDR_SAMPLE, -1, -1); // each sample schedules the next
+    }
+    if(!ctx->faults.empty()) {                          // one pending event for the next fault time
+        schedule_event(&s, ctx->faults.next_time(), EV_FAULT, -1, -1);
+    }
+    for(int ac=0; ac<size; ac++) {                      // all flights airborne at t=0
+        ctx->fleet[ac]->set_status(IN_FLIGHT);
+        reschedule_aircraft(&s, ac, milliseconds(0));
+    }
+    run_events(&s);
+}
+
+/**
+ * @brief Continues a run from a checkpoint. The context must have been restored by
+ *        restore_sim_context() from the same reader, the engine state follows it.
+ *        Without what_if the run continues bit exactly. With what_if it is a branch:
+ *        every aircraft is advanced to now, the branch settings are applied and all
+ *        aircraft and the fault process are rescheduled from now. Without a recorder
+ *        the pending samples are dropped.
+ *
+ * @param ctx Pointer to the restored simulation context.
+ * @param r Pointer to the reader, at the engine state.
+ * @param now Simulation time of the checkpoint.
+ * @param end_time Simulation time at which the run ends.
+ * @param what_if Settings of a what-if branch, nullptr to continue the saved run.
+ *
+ * @return False if the engine state is damaged, nothing is run then.
+ */
+bool des_resume(_sim_context *ctx, ckpt_reader *r, milliseconds now, milliseconds end_time, const _sim_config *what_if) {
+    if(!ctx) {
+        return false;
+    }
+    int size = ctx->cfg.aircrafts;
+    _des_state s;
+    init_des_state(&s, ctx, end_time, 0, now);
+    r->get(&s.seq);
+    r->get(&s.charger_clock);
+    r->get_array(s.last_update, size);
+    r->get_array(s.epoch, size);
+    r->get_records(&s.events);
+    bool ok = r->good() && is_heap(s.events.begin(), s.events.end(), _event_later());
+    for(size_t k=0; ok && (k<s.events.size()); k++) {
+        ok = (s.events[k].ac_num >= -1) && (s.events[k].ac_num < size) && ((s.events[k].ac_num >= 0) || (s.events[k].epoch < 0));
+    }
+    if(!ok) {
+        return false;
+    }
+
+    if(what_if) {
+        bool recorder = ctx->fdr.is_running();
+        s.events.erase(remove_if(s.events.begin(), s.events.end(), [recorder](const _sim_event &ev) {
+            return (ev.type == EV_FAULT) || ((ev.type == EV_FDR_SAMPLE) && !recorder);
+        }), s.events.end());                            // the fault chain is scheduled again below
+        make_heap(s.events.begin(), s.events.end(), _event_later());
+        for(int ac=0; ac<size; ac++) {
+            advance_aircraft(&s, ac, now);
+        }
+        apply_what_if(ctx, *what_if, now);
+        for(int ac=0; ac<size; ac++) {
+            reschedule_aircraft(&s, ac, now);
+        }
+        if(!ctx->faults.empty()) {
+            schedule_event(&s, ctx->faults.next_time(), EV_FAULT, -1, -1);
+        }
+        service_chargers(&s, now);                      // added chargers take waiting aircraft
+    }
+    run_events(&s);
+    return true;
+}
@@ -2,121 +2,207 @@
  * @brief   Flight Data Recorder file  
  * @details This file contains the flight data recorder functions for the eVtol simulation problem from Joby Avation.
  *          File contains file IO functions, fault service and fault injection algorithm. 
+ *          The recorder snapshots the fleet, fdr_writer writes the text log or the binary columnar format.
  * 
  * @author  Deepak E Kapure
  * @date    07-02-2025 
  * 
  */
 
-#include "../includes/definitions.hpp"
+#include "../includes/sim_context.hpp"
 #include "../includes/ac_simul.hpp"
-#include <random>
+#include "../includes/philox.hpp"
+#include "../includes/instrument.hpp"
+#include "../includes/timer.hpp"
 #include <cmath>
 #include <sstream>
 #include <iomanip>
+#include <cstring>
+
+static string input_log = "evtol_sim_input.txt";
+static const string base_log_header = " Aircraft_num Company Status Flight_time Miles_travelled Battery_soc Charger_id Charge_time Fault_count Charge_sessions ";
 
 /**
- * @brief Macro for fault service execution interval in milliseconds
- * 
+ * @brief Builds the runtime parameter map of the built-in companies.
+ *        Format: { company, { speed (mph), battery capacity (Wh), time to charge (hours x 100), energy use (Wh/mile), passengers } }
+ *
+ * @return Parameter map.
  */
-#define FDR_INTERVAL                (2000)
-#define FAULT_SERVICE_INTERVAL      (20)
+static _ac_map builtin_ac_map(void) {
+    _ac_map m;
+    for(int c=0; c<TOTAL_CATEGORIES; c++) {
+        const _ac_spec &s = company_specs[c];
+        m[(_ac_type)c] = {s.speed, s.batt_cap, s.toc_hrs, s.energy_use, s.passengers};
+    }
+    return m;
+}
 
-static string input_log = "evtol_sim_input.txt";
-ofstream fp_in;
-
-static map<int, string> comp_map = {
-    { 0, "ALPHA" },
-    { 1, "BETA" },
-    { 2, "CHARLIE" },
-    { 3, "DELTA" },
-    { 4, "ECHO" }
-};
-
-static map<int, int> p_map = {
-    { 0, 4 },
-    { 1, 5 },
-    { 2, 3 },
-    { 3, 2 },
-    { 4, 2 }
-};
+/**
+ * @brief Builds the runtime failure probability map (per hour) of the built-in companies.
+ *
+ * @return Probability map.
+ */
+static _prob_map builtin_prob_map(void) {
+    _prob_map m;
+    for(int c=0; c<TOTAL_CATEGORIES; c++) {
+        m[(_ac_type)c] = company_specs[c].fault_prob;
+    }
+    return m;
+}
+
+/**
+ *  @brief Aircraft parameters and failure probabilities per hour, by company. Generic
+ *         runtime form of company_specs, custom companies are passed in the same form.
+ */
+_ac_map paramter_map = builtin_ac_map();
+_prob_map probablity_map = builtin_prob_map();
 
 milliseconds fdr_curr(0);
 milliseconds fault_curr(0);
+static _timer_id fdr_timer = timer_register(milliseconds(FDR_INTERVAL));
+static _timer_id fault_timer = timer_register(milliseconds(FAULT_SERVICE_INTERVAL));
 
 /**
- *  @brief Real-time calculation factors. The eVTOL_Simul_analysis.xlsx file contains 
- *         the analysis behind these factors.
- *         Format:
- *         { company, { energy used per simulation time, battery cap per % soc, miles travelled per simul time x 100 } }
- */  
-map<_ac_type, vector<double>> calc_factors = {
-    { ALPHA,   {3.2, 3200, 0.002} },
-    { BRAVO,   {2.5, 1000, 0.001666} },
-    { CHARLIE, {5.8666, 2200, 0.002666} },
-    { DELTA,   {1.2, 1200, 0.0015} },
-    { ECHO,    {2.9, 1500, 0.0005} }
-}; 
+ * @brief Resolves the specification every company runs with from the parameter map.
+ *        A company missing from the map keeps its built-in specification.
+ *
+ * @param fs Pointer to the fleet store.
+ * @param map Pointer to aircraft configuration map.
+ *
+ * @return None
+ */
+static void resolve_specs(_fleet_store *fs, _ac_map *map) {
+    for(int c=0; c<TOTAL_CATEGORIES; c++) {
+        _ac_spec spec = company_specs[c];
+        if(map && (map->count((_ac_type)c) > 0) && (map->at((_ac_type)c).size() >= 5)) {
+            const vector<int> &para = map->at((_ac_type)c);
+            spec.speed = para[0];
+            spec.batt_cap = para[1];
+            spec.toc_hrs = para[2];
+            spec.energy_use = para[3];
+            spec.passengers = para[4];
+        }
+        fs->spec[c] = spec;
+    }
+}
+
+/**
+ * @brief Splits the fleet into contiguous runs of one company, marking the runs whose
+ *        company uses its built-in specification for the compile time flight kernel.
+ *
+ * @param fs Pointer to the fleet store, companies set.
+ * @param size Number of aircraft.
+ *
+ * @return None
+ */
+static void build_fleet_runs(_fleet_store *fs, int size) {
+    fs->runs.clear();
+    for(int ac=0; ac<size; ac++) {
+        int c = fs->company[ac];
+        if(fs->runs.empty() || (fs->runs.back().company != c)) {
+            fs->runs.push_back({ac, ac, c, same_spec(fs->spec[c], company_specs[c])});
+        }
+        fs->runs.back().end = ac + 1;
+    }
+}
 
 /**
  * @brief Initializes and populates the aircraft array with categorized aircraft.
  *        Randomly distributes aircraft across types and creates instances accordingly.
+ *        The mix is drawn from the fleet mix stream of the master seed, unless the
+ *        configuration sets a fixed mix (cfg.mix) or an explicit manifest (cfg.manifest),
+ *        which gives the company of every aircraft in aircraft number order.
  *
- * @param ac_array Array to store aircraft pointers.
- * @param size Total number of aircraft.
+ * @param ctx Pointer to the simulation context, fleet is filled in place.
  * @param map Pointer to aircraft configuration map.
  * @param categories Number of aircraft categories.
  *
  * @return None
  */
-void create_aircrafts(aircraft **ac_array, int size, _ac_map *map, int categories) {
+void create_aircrafts(_sim_context *ctx, _ac_map *map, int categories) {
     vector<int> cat_count(categories, 1);            // init array to atleasst 1 for each type
     ostringstream line;
 
-    int remain = (size - categories);
-    srand(time(0));                                  // init RNG
-    while(remain--) {
-        cat_count[(rand()%categories)]++;            // assign randomly count for each type 
+    int size = ctx->cfg.aircrafts;
+    int mixed = 0;
+    for(int i=0; i<categories; i++) {
+        mixed += max(0, ctx->cfg.mix[i]);
     }
-    cout << "Alpha: " << cat_count[0] << " ";
-    cout << "Bravo: " << cat_count[1] << " ";
-    cout << "Charlie: " << cat_count[2] << " ";
-    cout << "Delta: " << cat_count[3] << " ";
-    cout << "Echo: " << cat_count[4] << endl;
-
-    line << "Alpha: " << cat_count[0] << " ";
-    line << "Bravo: " << cat_count[1] << " ";
-    line << "Charlie: " << cat_count[2] << " ";
-    line << "Delta: " << cat_count[3] << " ";
-    line << "Echo: " << cat_count[4];
-
-    fp_in = open_log_file(input_log);
-    write_to_file(fp_in, line.str());
-
-    size--;
-    for(int type=(TOTAL_CATEGORIES-1); type>=0; type--) {       // fill aircraft array
-        while(cat_count[type]) {
-            ac_array[size] = new aircraft(size, (_ac_type)type, map, &calc_factors);
-            size--;
-            cat_count[type]--;
+    const vector<uint8_t> *manifest = ctx->cfg.manifest;
+    if(manifest && ((int)manifest->size() == size)) {
+        fill(cat_count.begin(), cat_count.end(), 0);
+        for(uint8_t c: *manifest) {
+            cat_count[c]++;
+        }
+    } else if(mixed > 0) {
+        for(int i=0; i<categories; i++) {            // fixed mix
+            cat_count[i] = max(0, ctx->cfg.mix[i]);
         }
+    } else {
+        int remain = (size - categories);
+        philox_rng rng(ctx->cfg.seed, RNG_STREAM_FLEET_MIX);
+        while(remain--) {
+            cat_count[rng.below(categories)]++;      // assign randomly count for each type 
+        }
+    }
+    if(ctx->cfg.log_inputs) {
+        cout << "Alpha: " << cat_count[0] << " ";
+        cout << "Bravo: " << cat_count[1] << " ";
+        cout << "Charlie: " << cat_count[2] << " ";
+        cout << "Delta: " << cat_count[3] << " ";
+        cout << "Echo: " << cat_count[4] << endl;
+
+        line << "Alpha: " << cat_count[0] << " ";
+        line << "Bravo: " << cat_count[1] << " ";
+        line << "Charlie: " << cat_count[2] << " ";
+        line << "Delta: " << cat_count[3] << " ";
+        line << "Echo: " << cat_count[4] << "\n";
+        line << "Seed: " << ctx->cfg.seed;
+
+        ofstream fp_in = open_log_file(input_log);
+        write_to_file(fp_in, line.str());
+        close_file(fp_in);
     }
+
+    ctx->arena.reserve((size_t)size * sizeof(aircraft) + alignof(aircraft));  // whole fleet in one block
+    resolve_specs(&ctx->store, map);
+    if(manifest && ((int)manifest->size() == size)) {
+        for(int ac=0; ac<size; ac++) {                          // fill aircraft array in manifest order
+            ctx->fleet[ac] = ctx->arena.create<aircraft>(ac, (_ac_type)(*manifest)[ac], &ctx->store);
+            ctx->fleet[ac]->set_limits(ctx->cfg.downtime_hours * SIMULATION_FACTOR, ctx->cfg.soc_threshold, ctx->cfg.charger_power);
+        }
+        for(int type=0; type<categories; type++) {
+            ctx->live.add(type, LIVE_AIRCRAFTS, cat_count[type]);
+        }
+    } else {
+        size--;
+        for(int type=(TOTAL_CATEGORIES-1); type>=0; type--) {   // fill aircraft array
+            while(cat_count[type]) {
+                ctx->fleet[size] = ctx->arena.create<aircraft>(size, (_ac_type)type, &ctx->store);
+                ctx->fleet[size]->set_limits(ctx->cfg.downtime_hours * SIMULATION_FACTOR, ctx->cfg.soc_threshold, ctx->cfg.charger_power);
+                ctx->live.add(type, LIVE_AIRCRAFTS, 1);
+                size--;
+                cat_count[type]--;
+            }
+        }
+    }
+    build_fleet_runs(&ctx->store, ctx->cfg.aircrafts);
 }
 
 /**
- * @brief Deletes dynamically allocated aircraft objects in the array.
+ * @brief Releases the aircraft objects and the per-run scratch in one shot. The arena
+ *        keeps its memory, so a reused context creates the next fleet without allocating.
  *
- * @param ac_array Array of pointers to aircraft objects.
- * @param size Number of aircraft in the array.
+ * @param ctx Pointer to the simulation context.
  *
  * @return None
  */
-void delete_aircrafts(aircraft **ac_array, int size) {
-    if((ac_array) && (size)) {
-        size--;
-        while(size) {
-            delete ac_array[size--];
+void delete_aircrafts(_sim_context *ctx) {
+    if(ctx) {
+        for(auto &plane: ctx->fleet) {
+            plane = nullptr;
         }
+        ctx->arena.reset();
     }
 }   
 /**
@@ -124,71 +210,74 @@ void delete_aircrafts(aircraft **ac_array, int size) {
  */
 /**
  * @brief Injects faults into aircraft based on exponential failure probability.
- *        Generates fault events over simulation time and inserts them into the fault map.
+ *        Arms the fault schedule: each aircraft draws only its first fault time, the next one
+ *        is drawn when it fires, so setup does not depend on the simulated horizon.
+ *        Each aircraft draws from its own stream of the master seed, so the schedule of an
+ *        aircraft does not depend on the fleet size or on the order of the draws.
  *        Ref: https://cplusplus.com/reference/random/exponential_distribution/
  *             https://www.geeksforgeeks.org/probability-distributions-exponential-distribution/
  *             https://www.scribbr.com/statistics/poisson-distribution/
  *
  * @param pmap Pointer to the failure probability map by aircraft company.
- * @param ac_array Array of aircraft pointers.
- * @param size Number of aircraft.
- * @param q Pointer to the fault event map (timestamp to aircraft number).
+ * @param ctx Pointer to the simulation context, faults are added to its fault schedule.
  *
  * @return None
  */
-void fault_injection(_prob_map *pmap, aircraft **ac_array, int size, _fault_map *q) {
-    double lambda_min, next_failure;
-    int total_minutes = SIMULATION_TIME_HRS * HRS_TO_MINUTES; 
+void fault_injection(_prob_map *pmap, _sim_context *ctx) {
+    double lambda_min;
+    double total_minutes = ctx->cfg.sim_hours * HRS_TO_MINUTES;
+    int size = ctx->cfg.aircrafts;
+    fault_schedule *q = &ctx->faults;
     ostringstream line;
     
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::exponential_distribution<> exp_dist;
+    philox_rng rng;
 
-    int current_time = 0;
     _ac_info *plane;
+    q->init(size, total_minutes);
+    for(int c=0; c<TOTAL_CATEGORIES; c++) {                 // kept with the specs, a checkpoint restores it
+        ctx->store.spec[c].fault_prob = (pmap->count((_ac_type)c) > 0) ? pmap->at((_ac_type)c) : company_specs[c].fault_prob;
+    }
     for(int i=0; i<size; i++) {
-        plane = (ac_array[i])->get_ac_info();
-        lambda_min = (pmap->at(plane->company))/60.0;
-        exp_dist.param(std::exponential_distribution<>::param_type(lambda_min));
-        while (current_time < total_minutes) {
-            next_failure = exp_dist(gen);
-            current_time += next_failure;
-            if (current_time < total_minutes) {
-                q->insert({ milliseconds(current_time*1000), (plane->ac_num)});
+        plane = (ctx->fleet[i])->get_ac_info();
+        lambda_min = (pmap->at(plane->company) * ctx->cfg.fault_scale)/60.0;
+        rng.set_stream(ctx->cfg.seed, i);                   // own stream per aircraft
+        q->arm(plane->ac_num, rng, lambda_min);             // only the first fault is drawn here
+    }
+    if(ctx->cfg.log_inputs) {
+        line << "Faults:" << endl;
+        if(ctx->cfg.dump_faults) {                          // debug, materializes the whole schedule
+            vector<_fault_event> all;
+            q->dump(&all);
+            for(auto& i: all) {
+                line << "Aircraft_number: " << i.ac_num << " Time: " << (i.time).count() << endl;
             }
         }
-        current_time = 0;
-    }
-    line << "Faults:" << endl;
-    for(auto& i: *q) {
-        line << "Aircraft_number: " << i.second << " Time: " << (i.first).count() << endl;
+        line << "Total_time: " << ctx->cfg.sim_hours << " hours " 
+             << "Simulation_Time: " << ctx->cfg.sim_hours << " minutes";
+        ofstream fp_in(input_log, ios::out | ios::app);
+        write_to_file(fp_in, line.str());
+        close_file(fp_in);
     }
-    line << "Total_time: " << SIMULATION_TIME_HRS << " hours " 
-         << "Simulation_Time: " << SIMULATION_TIME_HRS << " minutes";
-    write_to_file(fp_in, line.str());
-    
-    close_file(fp_in);
 }
 
 /**
  * @brief Checks and injects faults based on scheduled fault events.
- *        Sets fault signals for aircraft when the fault time is reached and removes events from the queue.
+ *        Sets fault signals for every aircraft whose fault time is reached, all due faults in one pass.
  *
- * @param q Pointer to the fault event map (timestamp to aircraft number).
+ * @param ctx Pointer to the simulation context holding the fault schedule.
  *
  * @return None
  */
-void fault_service(_fault_map *q) {
+void fault_service(_sim_context *ctx) {
     milliseconds interval(FAULT_SERVICE_INTERVAL);
-    if(isduration(fault_curr, interval) && q && !(q->empty())) {                        // enter only if map list is not empty
-        auto entry = q->begin();
+    fault_schedule *q = (ctx) ? &ctx->faults : nullptr;
+    if(timer_due(fault_timer) && q && !(q->empty())) {                                  // enter only if faults are pending
+        INSTR_TICK(PROBE_FAULTS, timer_wall_time(interval));
+        INSTR_SCOPE(PROBE_FAULTS);
         get_counter_val(&fault_curr);
-        if((fault_curr) >= (entry->first)) {              // check if its time for fault 
-            //cout << "Injecting fault for " << entry->second << endl; 
-            set_fault_sig(entry->second, 1);        // set the fault signal for Aircraft
-            q->erase(entry);                        // remove from map
-        }
+        q->dispatch_due(fault_curr, [ctx](int ac) {
+            post_fault(ctx, ac);                    // post the fault to the Aircraft mailbox
+        });
     }
 }
 
@@ -196,11 +285,12 @@ void fault_service(_fault_map *q) {
  * @brief Opens a file for writing, creating or overwriting it.
  *
  * @param filename Name of the file to open.
+ * @param binary Open in binary mode, for the binary flight data recorder.
  *
  * @return ofstream object associated with the file.
  */
-ofstream open_log_file(const string &filename) {
-    ofstream outfile(filename, ios::out);  
+ofstream open_log_file(const string &filename, bool binary) {
+    ofstream outfile(filename, binary ? (ios::out | ios::binary) : ios::out);  
     return outfile;  
 }
 
@@ -236,44 +326,190 @@ bool write_to_file(ofstream &outfile, const string &line) {
 }
 
 /**
- * @brief Records aircraft data at fixed intervals and writes to the output file.
- *        Collects flight and charging parameters from all aircraft and logs them as a single line.
- *        Data line:
- *        {"timestamp" "ac_num" "company" "status" "flight_time" "miles_travelled" "battery_soc" "c_id" "charge_time" "fault_count" "charge_sessions" ...}
+ * @brief Records aircraft data at fixed intervals. Only takes a snapshot, the writer
+ *        thread formats and writes it. A sample taken more than FDR_LATE_TOLERANCE after
+ *        its interval is counted as late.
  * 
- * @param ac_array Array of pointers to aircraft objects.
- * @param size Number of aircraft in the array.
- * @param outfile Output file stream to write the data.
+ * @param ctx Pointer to the simulation context.
  *
  * @return None
  */
-void data_recorder_service(aircraft **ac_array, int size, ofstream &outfile) {
-    milliseconds interval(FDR_INTERVAL);
-    if((ac_array) && (size>=0) && isduration(fdr_curr, interval)) {
+void data_recorder_service(_sim_context *ctx) {
+    if((ctx) && timer_due(fdr_timer)) {
+        milliseconds interval(ctx->cfg.fdr_interval);
+        INSTR_TICK(PROBE_FDR, timer_wall_time(interval));
+        milliseconds last = fdr_curr;
         get_counter_val(&fdr_curr);
+        if((fdr_curr - last) > (interval + milliseconds(FDR_LATE_TOLERANCE))) {
+            ctx->fdr.note_late();
+        }
+        record_flight_data(ctx, fdr_curr);
+    }
+}
+
+/**
+ * @brief Writes the flight data recorder header. Text format gets the column names
+ *        repeated per aircraft, binary formats get the schema header followed by the
+ *        company names and the company of each aircraft.
+ *
+ * @param ctx Pointer to the simulation context. Fleet must be created.
+ * @param outfile Output file stream to write the header.
+ *
+ * @return None
+ */
+void write_fdr_header(_sim_context *ctx, ofstream &outfile) {
+    if(!ctx || !outfile.is_open()) {
+        return;
+    }
+    int size = ctx->cfg.aircrafts;
+    if(ctx->cfg.fdr_format == FDR_TEXT) {
+        string extended_header = "Timestamp";
+        for(auto ac=0; ac<size; ac++) {
+            extended_header.append(base_log_header);
+        }
+        write_to_file(outfile, extended_header);
+        return;
+    }
+
+    _fdr_file_header hdr = {};
+    memcpy(hdr.magic, FDR_MAGIC, FDR_MAGIC_LEN);
+    hdr.version = FDR_VERSION;
+    hdr.aircrafts = size;
+    hdr.columns = FDR_TOTAL_COLUMNS;
+    hdr.companies = TOTAL_CATEGORIES;
+    hdr.interval = ctx->cfg.fdr_interval;
+    hdr.scale = FDR_FIXED_SCALE;
+    outfile.write((const char *)&hdr, sizeof(hdr));
 
-        ostringstream line;
-        line << fdr_curr.count() << " ";
-        for (int i = 0; i < TOTAL_AIRCRAFTS; ++i) {
-            aircraft *ac = ac_array[i];
-
-            line << ac->get_ac_num() << " ";
-            line << comp_map.at(ac->get_company()) << " ";
-            line << ac->get_ac_status() << " ";
-            line << fixed << setprecision(4) << ac->get_flight_time() << " ";
-            line << fixed << setprecision(4) << ac->get_miles() << " ";
-            line << fixed << setprecision(4) << ac->get_battery_soc() << " ";
-            line << ac->get_charger_id() << " ";
-            line << fixed << setprecision(4) << ac->get_charge_time() << " ";
-            line << ac->get_fault_count() << " ";
-            line << ac->get_charger_sessions() << " ";
+    for(int c=0; c<FDR_TOTAL_COLUMNS; c++) {
+        _fdr_column_desc col = {};
+        strncpy(col.name, fdr_schema[c].name, FDR_NAME_LEN - 1);
+        col.width = fdr_schema[c].width;
+        col.encoding = ((ctx->cfg.fdr_format == FDR_BINARY_DELTA) && fdr_schema[c].counter) ? FDR_DELTA : FDR_RAW;
+        col.fixed = fdr_schema[c].fixed;
+        outfile.write((const char *)&col, sizeof(col));
+    }
+    for(int i=0; i<TOTAL_CATEGORIES; i++) {
+        char name[FDR_NAME_LEN] = {};
+        strncpy(name, company_specs[i].name, FDR_NAME_LEN - 1);
+        outfile.write(name, FDR_NAME_LEN);
+    }
+    outfile.write((const char *)ctx->store.company.data(), size);
+
+}
+
+/**
+ * @brief Starts the flight data recorder writer thread on the given stream. The event
+ *        engine batches many samples per buffer and never drops, the wall-clock paced
+ *        run hands over every sample right away and drops samples while the writer is behind,
+ *        unless it free runs (-x max).
+ *
+ * @param ctx Pointer to the simulation context. Fleet must be created.
+ * @param outfile Output file stream, header already written.
+ *
+ * @return None
+ */
+void start_fdr_writer(_sim_context *ctx, ofstream &outfile) {
+    if(ctx) {
+        vector<string> names;
+        names.reserve(ctx->cfg.aircrafts);
+        for(auto ac: ctx->fleet) {
+            names.push_back(company_specs[ac->get_company()].name);
         }
-        // dump to file
-        write_to_file(outfile, line.str());
+        size_t sample_bytes = (1 + (size_t)FDR_TOTAL_COLUMNS * ctx->cfg.aircrafts) * sizeof(int64_t);
+        bool paced = ctx->cfg.realtime && (ctx->cfg.time_scale > 0);    // free running waits for the writer like the event engine
+        int per_buffer = paced ? 1 : max(1, (int)(FDR_BUFFER_BYTES / sample_bytes));
+        ctx->fdr.start(&outfile, ctx->cfg.fdr_format, names, per_buffer, !paced);
+        timer_set_interval(fdr_timer, milliseconds(ctx->cfg.fdr_interval));
     }
 }
 
-void sim_analysis(aircraft **ac_array, int size, int categories, ofstream &outfile) {
+/**
+ * @brief Writes all pending samples and stops the flight data recorder writer thread.
+ *
+ * @param ctx Pointer to the simulation context.
+ *
+ * @return None
+ */
+void stop_fdr_writer(_sim_context *ctx) {
+    if(ctx) {
+        ctx->fdr.finish();
+    }
+}
+
+/**
+ * @brief Gets the raw value of a recorded column for one aircraft. Fixed point columns
+ *        are scaled to integers here, so the writer only deals with integers.
+ *
+ * @param ctx Pointer to the simulation context.
+ * @param col Column.
+ * @param ac Aircraft number.
+ *
+ * @return Column value.
+ */
+static inline int64_t fdr_column_value(_sim_context *ctx, int col, int ac) {
+    const _fleet_store &fs = ctx->store;
+    aircraft *plane = ctx->fleet[ac];
+    switch(col) {
+        case FDR_COL_STATUS:          return fs.status[ac];
+        case FDR_COL_FLIGHT_TIME:     return llround(fs.flight_time[ac] * FDR_FIXED_SCALE);
+        case FDR_COL_MILES:           return llround(fs.miles_travelled[ac] * FDR_FIXED_SCALE);
+        case FDR_COL_BATTERY_SOC:     return llround(fs.battery_soc[ac] * FDR_FIXED_SCALE);
+        case FDR_COL_CHARGER_ID:      return plane->get_charger_id();
+        case FDR_COL_CHARGE_TIME:     return llround(plane->get_charge_time() * FDR_FIXED_SCALE);
+        case FDR_COL_FAULT_COUNT:     return (int64_t)plane->get_fault_count();
+        case FDR_COL_CHARGE_SESSIONS: return plane->get_charger_sessions();
+        default:                      return 0;
+    }
+}
+
+/**
+ * @brief Snapshots all aircraft at the given timestamp into the recorder buffer, column
+ *        by column. Shared by the periodic recorder and the event engine.
+ *
+ * @param ctx Pointer to the simulation context. start_fdr_writer() must have been called.
+ * @param stamp Simulation timestamp of the sample.
+ *
+ * @return None
+ */
+void record_flight_data(_sim_context *ctx, milliseconds stamp) {
+    if(ctx) {
+        INSTR_SCOPE(PROBE_FDR);
+        int64_t *slot = ctx->fdr.begin_sample(stamp.count());
+        if(slot) {
+            int size = ctx->cfg.aircrafts;
+            for(int c=0; c<FDR_TOTAL_COLUMNS; c++) {
+                int64_t *col = &slot[(size_t)c * size];
+                for(int ac=0; ac<size; ac++) {
+                    col[ac] = fdr_column_value(ctx, c, ac);
+                }
+            }
+            ctx->fdr.end_sample();
+        }
+    }
+}
+
+/**
+ * @brief Gets the display name of a company.
+ *
+ * @param company Company (_ac_type).
+ *
+ * @return Company name.
+ */
+const char *company_name(int company) {
+    return company_specs[company].name;
+}
+
+/**
+ * @brief Computes the per company flight, charge and fault statistics of a finished run.
+ *
+ * @param ctx Pointer to the simulation context.
+ * @param m Filled with the metrics, indexed by company and _sim_metric.
+ *
+ * @return None
+ */
+void compute_sim_metrics(_sim_context *ctx, _sim_metrics *m) {
+    int categories = TOTAL_CATEGORIES;
     vector<int> cat_count(categories, 0);
     vector<double>  f_time(categories, 0.0);
     vector<double>  miles(categories, 0.0);
@@ -281,7 +517,8 @@ void sim_analysis(aircraft **ac_array, int size, int categories, ofstream &outfi
     vector<int>  c_sessions(categories, 0.0);
     vector<int>  f_count(categories, 0);
 
-    for(int i=0; i<size; i++) {
+    aircraft **ac_array = ctx->fleet.data();
+    for(int i=0; i<ctx->cfg.aircrafts; i++) {
         cat_count.at(ac_array[i]->get_company())++;
         f_time[ac_array[i]->get_company()] += ac_array[i]->get_flight_time();
         miles[ac_array[i]->get_company()] += ac_array[i]->get_miles();
@@ -290,18 +527,106 @@ void sim_analysis(aircraft **ac_array, int size, int categories, ofstream &outfi
         f_count[ac_array[i]->get_company()] += ac_array[i]->get_fault_count();
     }
 
+    for(int i=0; i<categories; i++) {
+        if(c_sessions.at(i) == 0) c_sessions[i] = 1; 
+        int flights = (cat_count.at(i) > 0) ? cat_count.at(i) : 1;     // company left out of a fixed mix
+        m->value[i][MET_FLIGHTS] = cat_count.at(i);
+        m->value[i][MET_AVG_FLIGHT_TIME] = f_time.at(i)/flights;
+        m->value[i][MET_AVG_DISTANCE] = miles.at(i)/flights;
+        m->value[i][MET_AVG_CHARGE_TIME] = c_time.at(i)/c_sessions.at(i);
+        m->value[i][MET_TOTAL_FAULTS] = f_count.at(i);
+        m->value[i][MET_PASSENGER_MILES] = miles.at(i)*cat_count.at(i)*ctx->store.spec[i].passengers;
+    }
+}
+
+/**
+ * @brief Computes the per company metrics from a live statistics snapshot, same metrics
+ *        as compute_sim_metrics(). Only completed flight segments and ended charge sessions
+ *        are included until the run has ended and finish_live_stats() was called.
+ *
+ * @param fs Pointer to the fleet store, for the passengers per company.
+ * @param s Pointer to the snapshot.
+ * @param m Filled with the metrics, indexed by company and _sim_metric.
+ *
+ * @return None
+ */
+void compute_live_metrics(_fleet_store *fs, _fleet_live_stats::snapshot_t *s, _sim_metrics *m) {
+    for(int i=0; i<TOTAL_CATEGORIES; i++) {
+        double count = s->value[i][LIVE_AIRCRAFTS];
+        double flights = (count > 0) ? count : 1;
+        double sessions = (s->value[i][LIVE_CHARGE_SESSIONS] > 0) ? s->value[i][LIVE_CHARGE_SESSIONS] : 1;
+        m->value[i][MET_FLIGHTS] = count;
+        m->value[i][MET_AVG_FLIGHT_TIME] = s->value[i][LIVE_FLIGHT_TIME]/flights;
+        m->value[i][MET_AVG_DISTANCE] = s->value[i][LIVE_MILES]/flights;
+        m->value[i][MET_AVG_CHARGE_TIME] = s->value[i][LIVE_CHARGE_TIME]/sessions;
+        m->value[i][MET_TOTAL_FAULTS] = s->value[i][LIVE_FAULTS];
+        m->value[i][MET_PASSENGER_MILES] = s->value[i][LIVE_MILES]*count*fs->spec[i].passengers;
+    }
+}
+
+/**
+ * @brief Books the open flight segments and charge sessions of the fleet in the live
+ *        statistics, so they cover the whole run. Call once the run has ended.
+ *
+ * @param ctx Pointer to the simulation context.
+ *
+ * @return None
+ */
+void finish_live_stats(_sim_context *ctx) {
+    if(ctx) {
+        for(auto plane: ctx->fleet) {
+            plane->book_open(&ctx->live);
+        }
+    }
+}
+
+/**
+ * @brief Writes a one line live summary from a snapshot of the live statistics:
+ *        per company segments, flight hours, miles, charge sessions and faults.
+ *        Safe to call from any thread while the simulation runs.
+ *
+ * @param ctx Pointer to the simulation context.
+ * @param out Output stream.
+ *
+ * @return None
+ */
+void live_report(_sim_context *ctx, ostream &out) {
+    _fleet_live_stats::snapshot_t s;
+    ctx->live.snapshot(&s);
+    ostringstream line;
+    line << "Live[" << s.version << "]:";
+    for(int i=0; i<TOTAL_CATEGORIES; i++) {
+        line << " " << company_specs[i].name << " seg=" << s.value[i][LIVE_SEGMENTS] << " hrs=" << s.value[i][LIVE_FLIGHT_TIME]
+             << " mi=" << s.value[i][LIVE_MILES] << " chg=" << s.value[i][LIVE_CHARGE_SESSIONS]
+             << " flt=" << s.value[i][LIVE_FAULTS];
+    }
+    out << line.str() << endl;
+}
+
+/**
+ * @brief Summarizes per company flight, charge and fault statistics and writes them to the output file.
+ *
+ * @param ctx Pointer to the simulation context.
+ * @param categories Number of aircraft categories.
+ * @param outfile Output file stream to write the results.
+ *
+ * @return None
+ */
+void sim_analysis(_sim_context *ctx, int categories, ofstream &outfile) {
+    _sim_metrics m;
+    compute_sim_metrics(ctx, &m);
+
     ostringstream line;  line << "\n\n";
     line << "Simulation_Results:\n";
     for(int i=0; i<categories; i++) {
-        line << comp_map.at(i) << "\n";
-        line << "Number_of_Flights: " << cat_count.at(i) << "\n";
-        line << "Avg_flight_time(hrs): " << (f_time.at(i)/cat_count.at(i)) << "\n";
-        line << "Avg_distance_per_flight(mile): " << (miles.at(i)/cat_count.at(i)) << "\n";
-        if(c_sessions.at(i) == 0) c_sessions[i] = 1; 
-        line << "Average_charge_time(hrs): " << (c_time.at(i)/c_sessions.at(i)) << "\n";
-        line << "Total_faults: " << f_count.at(i) << "\n";
-        line << "Total_passenger_miles(miles): " << (miles.at(i)*cat_count.at(i)*p_map.at(i)) << "\n\n";
+        line << company_specs[i].name << "\n";
+        line << "Number_of_Flights: " << (int)m.value[i][MET_FLIGHTS] << "\n";
+        line << "Avg_flight_time(hrs): " << m.value[i][MET_AVG_FLIGHT_TIME] << "\n";
+        line << "Avg_distance_per_flight(mile): " << m.value[i][MET_AVG_DISTANCE] << "\n";
+        line << "Average_charge_time(hrs): " << m.value[i][MET_AVG_CHARGE_TIME] << "\n";
+        line << "Total_faults: " << (int)m.value[i][MET_TOTAL_FAULTS] << "\n";
+        line << "Total_passenger_miles(miles): " << m.value[i][MET_PASSENGER_MILES] << "\n\n";
     }    
 
     write_to_file(outfile, line.str());
-}
\ No newline at end of file
+}
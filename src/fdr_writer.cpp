@@ -0,0 +1,250 @@
+/**
+ * @brief   Flight Data Recorder writer file
+ * @details This file contains the asynchronous flight data recorder writer for the eVtol simulation problem
+ *          from Joby Avation. The simulation copies raw samples into one of two preallocated buffers, a
+ *          dedicated writer thread encodes the other buffer in the text or binary format and writes it to disk.
+ *
+ * @author  Deepak E Kapure
+ * @date    07-02-2025
+ *
+ */
+
+#include "../includes/fdr_writer.hpp"
+#include <cstdio>
+#include <cstring>
+
+/**
+ * @brief Creates an idle writer, start() launches the writer thread.
+ */
+fdr_writer::fdr_writer() : out(nullptr), format(FDR_TEXT), aircrafts(0), sample_words(1), per_buffer(1),
+                           lossless(true), active(0), busy{false, false}, stop(false), running(false),
+                           written(0), dropped(0), late(0) {}
+
+/**
+ * @brief Flushes pending samples and joins the writer thread.
+ */
+fdr_writer::~fdr_writer() {
+    finish();
+}
+
+/**
+ * @brief Allocates the snapshot buffers and starts the writer thread. The file header
+ *        must already be written, the writer only appends samples.
+ *
+ * @param o Output stream, owned by the caller and only written by the writer thread until finish().
+ * @param f Output format.
+ * @param names Company name of each aircraft, sets the number of aircraft per sample.
+ * @param samples_per_buffer Samples collected before a buffer is handed to the writer.
+ * @param wait True to wait for the writer when both buffers are busy, false to drop the sample.
+ *
+ * @return None
+ */
+void fdr_writer::start(ofstream *o, _fdr_format f, const vector<string> &names, int samples_per_buffer, bool wait) {
+    finish();
+    out = o;
+    format = f;
+    aircrafts = (int)names.size();
+    company = names;
+    sample_words = 1 + (size_t)FDR_TOTAL_COLUMNS * aircrafts;
+    per_buffer = (samples_per_buffer < 1) ? 1 : samples_per_buffer;
+    lossless = wait;
+    for(int i=0; i<2; i++) {
+        buffers[i].values.assign((size_t)per_buffer * sample_words, 0);
+        buffers[i].count = 0;
+        busy[i] = false;
+    }
+    active = 0;
+    prev.assign((size_t)FDR_TOTAL_COLUMNS * aircrafts, 0);
+    written.store(0, memory_order_relaxed);
+    dropped.store(0, memory_order_relaxed);
+    late.store(0, memory_order_relaxed);
+    stop = false;
+    running = true;
+    worker = thread(&fdr_writer::writer_loop, this);
+}
+
+/**
+ * @brief Hands the active buffer to the writer thread and switches to the other one.
+ *
+ * @param wait True to wait if the writer still owns the other buffer.
+ *
+ * @return False if the other buffer is busy and wait is false.
+ */
+bool fdr_writer::hand_off(bool wait) {
+    unique_lock<mutex> guard(lock);
+    int other = active ^ 1;
+    if(busy[other]) {
+        if(!wait) {
+            return false;
+        }
+        free_cv.wait(guard, [&]{ return !busy[other]; });
+    }
+    busy[active] = true;
+    active = other;
+    ready_cv.notify_one();
+    return true;
+}
+
+/**
+ * @brief Reserves the next sample slot in the active buffer.
+ *
+ * @param stamp Simulation timestamp of the sample.
+ *
+ * @return Storage for FDR_TOTAL_COLUMNS x aircraft values (column major), nullptr if the
+ *         sample was dropped. end_sample() must follow a successful call.
+ */
+int64_t *fdr_writer::begin_sample(int64_t stamp) {
+    if(!running) {
+        return nullptr;
+    }
+    if((buffers[active].count == per_buffer) && !hand_off(lossless)) {
+        dropped.fetch_add(1, memory_order_relaxed);     // writer is behind, drop instead of blocking
+        return nullptr;
+    }
+    _fdr_buffer *buf = &buffers[active];
+    int64_t *slot = &buf->values[(size_t)buf->count * sample_words];
+    slot[0] = stamp;
+    return slot + 1;
+}
+
+/**
+ * @brief Commits the sample reserved by begin_sample() and hands the buffer to the writer
+ *        once it is full. Never waits, a full buffer that cannot be handed off yet is
+ *        retried on the next sample.
+ *
+ * @return None
+ */
+void fdr_writer::end_sample() {
+    if(++buffers[active].count == per_buffer) {
+        hand_off(false);
+    }
+}
+
+/**
+ * @brief Hands off the partially filled buffer, waits until everything is written and
+ *        joins the writer thread.
+ *
+ * @return None
+ */
+void fdr_writer::finish() {
+    if(!running) {
+        return;
+    }
+    if(buffers[active].count > 0) {
+        hand_off(true);
+    }
+    {
+        lock_guard<mutex> guard(lock);
+        stop = true;
+    }
+    ready_cv.notify_one();
+    worker.join();
+    out->flush();
+    running = false;
+}
+
+/**
+ * @brief Writer thread body. Writes every buffer handed over by the simulation and
+ *        returns it empty.
+ *
+ * @return None
+ */
+void fdr_writer::writer_loop() {
+    while(true) {
+        int idx;
+        {
+            unique_lock<mutex> guard(lock);
+            ready_cv.wait(guard, [&]{ return stop || busy[0] || busy[1]; });
+            if(!busy[0] && !busy[1]) {
+                break;                                  // stopped and drained
+            }
+            idx = busy[0] ? 0 : 1;                      // the active buffer is never busy
+        }
+        write_buffer(&buffers[idx]);
+        {
+            lock_guard<mutex> guard(lock);
+            buffers[idx].count = 0;
+            busy[idx] = false;
+        }
+        free_cv.notify_one();
+    }
+}
+
+/**
+ * @brief Stores a signed value with the given width.
+ *
+ * @param dst Destination, may be unaligned.
+ * @param width Width in bytes (1, 4 or 8).
+ * @param v Value.
+ *
+ * @return None
+ */
+static inline void put_value(char *dst, int width, int64_t v) {
+    if(width == 1) {
+        int8_t n = (int8_t)v;
+        memcpy(dst, &n, 1);
+    } else if(width == 4) {
+        int32_t n = (int32_t)v;
+        memcpy(dst, &n, 4);
+    } else {
+        memcpy(dst, &v, 8);
+    }
+}
+
+/**
+ * @brief Encodes all samples of a buffer and writes them to the output stream. Runs on
+ *        the writer thread.
+ *        Text line:
+ *        {"timestamp" "ac_num" "company" "status" "flight_time" "miles_travelled" "battery_soc" "c_id" "charge_time" "fault_count" "charge_sessions" ...}
+ *
+ * @param buf Buffer to write.
+ *
+ * @return None
+ */
+void fdr_writer::write_buffer(_fdr_buffer *buf) {
+    const double scale = FDR_FIXED_SCALE;
+    int n = aircrafts;
+    for(int s=0; s<buf->count; s++) {
+        const int64_t *sample = &buf->values[(size_t)s * sample_words];
+        const int64_t *v = sample + 1;
+        if(format == FDR_TEXT) {
+            char field[160];
+            encoded.clear();
+            int len = snprintf(field, sizeof(field), "%lld ", (long long)sample[0]);
+            encoded.insert(encoded.end(), field, field + len);
+            for(int ac=0; ac<n; ac++) {
+                len = snprintf(field, sizeof(field), "%d %s %d %.4f %.4f %.4f %d %.4f %.4f %d ",
+                               ac, company[ac].c_str(), (int)v[FDR_COL_STATUS * n + ac],
+                               v[FDR_COL_FLIGHT_TIME * n + ac] / scale, v[FDR_COL_MILES * n + ac] / scale,
+                               v[FDR_COL_BATTERY_SOC * n + ac] / scale, (int)v[FDR_COL_CHARGER_ID * n + ac],
+                               v[FDR_COL_CHARGE_TIME * n + ac] / scale, (double)v[FDR_COL_FAULT_COUNT * n + ac],
+                               (int)v[FDR_COL_CHARGE_SESSIONS * n + ac]);
+                encoded.insert(encoded.end(), field, field + len);
+            }
+            encoded.push_back('\n');
+        } else {
+            bool delta = (format == FDR_BINARY_DELTA);
+            size_t size = sizeof(int64_t);
+            for(int c=0; c<FDR_TOTAL_COLUMNS; c++) {
+                size += (size_t)fdr_schema[c].width * n;
+            }
+            encoded.resize(size);
+            char *dst = encoded.data();
+            put_value(dst, 8, sample[0]);
+            dst += sizeof(int64_t);
+            for(int c=0; c<FDR_TOTAL_COLUMNS; c++) {
+                int width = fdr_schema[c].width;
+                int64_t *last = &prev[(size_t)c * n];
+                const int64_t *col = &v[(size_t)c * n];
+                bool col_delta = delta && fdr_schema[c].counter;
+                for(int ac=0; ac<n; ac++) {
+                    put_value(dst, width, col_delta ? (col[ac] - last[ac]) : col[ac]);
+                    last[ac] = col[ac];
+                    dst += width;
+                }
+            }
+        }
+        out->write(encoded.data(), encoded.size());
+    }
+    written.fetch_add(buf->count, memory_order_relaxed);
+}
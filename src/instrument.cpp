@@ -0,0 +1,88 @@
+/**
+ * @brief   Instrumentation file
+ * @details This file contains the hot path instrumentation of the eVtol simulation problem from Joby Avation.
+ *          Services record their call count, time per call and, for the wall-clock paced services, how late
+ *          they ran compared to their interval. Gauges sample the charge queue depth. Everything is compiled
+ *          out unless EVTOL_INSTRUMENT is defined (make INSTRUMENT=0 builds without it).
+ *
+ * @author  Deepak E Kapure
+ * @date    07-02-2025
+ *
+ */
+
+#include "../includes/instrument.hpp"
+
+#ifdef EVTOL_INSTRUMENT
+
+#include <sstream>
+#include <iomanip>
+
+_instr_probe_data instr_probes[TOTAL_PROBES];
+_instr_gauge_data instr_gauges[TOTAL_GAUGES];
+atomic<bool> instr_enabled(true);
+
+static const char *probe_names[TOTAL_PROBES] = {
+    "simulation", "charging", "faults", "fdr", "des_event"
+};
+static const char *gauge_names[TOTAL_GAUGES] = {
+    "charge_queue", "charge_waiting"
+};
+
+/**
+ * @brief Clears all probes and gauges.
+ *
+ * @return None
+ */
+void instr_reset() {
+    for(auto &p: instr_probes) {
+        p.calls.store(0, memory_order_relaxed);
+        p.duration.reset();
+        p.lateness.reset();
+        p.last_tick.store(0, memory_order_relaxed);
+    }
+    for(auto &g: instr_gauges) {
+        g.current.store(0, memory_order_relaxed);
+        g.level.reset();
+    }
+}
+
+/**
+ * @brief Writes the probe and gauge tables. Times in usec, lateness only for the
+ *        periodic services of the wall-clock paced run. Safe to call during the run.
+ *
+ * @param out Output stream.
+ *
+ * @return None
+ */
+void instr_report(ostream &out) {
+    ostringstream line;
+    line << fixed << setprecision(2);
+    line << "Instrumentation:\n";
+    line << "Probe Calls Mean_us P50_us P99_us P999_us Max_us Late_p50_us Late_p99_us Late_max_us\n";
+    for(int p=0; p<TOTAL_PROBES; p++) {
+        _instr_probe_data *d = &instr_probes[p];
+        uint64_t calls = d->calls.load(memory_order_relaxed);
+        if(calls == 0) {
+            continue;
+        }
+        line << probe_names[p] << " " << calls << " " << d->duration.mean() / 1000.0 << " "
+             << d->duration.quantile(0.5) / 1000.0 << " " << d->duration.quantile(0.99) / 1000.0 << " "
+             << d->duration.quantile(0.999) / 1000.0 << " " << d->duration.max_value() / 1000.0;
+        if(d->lateness.count() > 0) {
+            line << " " << d->lateness.quantile(0.5) / 1000.0 << " " << d->lateness.quantile(0.99) / 1000.0
+                 << " " << d->lateness.max_value() / 1000.0;
+        } else {
+            line << " - - -";
+        }
+        line << "\n";
+    }
+    line << "Gauge Current Mean P50 P99 Max\n";
+    for(int g=0; g<TOTAL_GAUGES; g++) {
+        _instr_gauge_data *d = &instr_gauges[g];
+        line << gauge_names[g] << " " << d->current.load(memory_order_relaxed) << " " << d->level.mean() << " "
+             << d->level.quantile(0.5) << " " << d->level.quantile(0.99) << " " << d->level.max_value() << "\n";
+    }
+    out << line.str();
+}
+
+#endif //EVTOL_INSTRUMENT
@@ -1,113 +1,482 @@
 /**
  * @brief   eVtol Simulation  
  * @details This file contains the main function and top level functions for the eVtol simulation problem from Joby Avation.
- *          Simulation run-time is set at 3 hours for 20 aircrafts as default. These parameters can be chaged by setting the macros in definition.hpp
- *          The simulation time resolution is 1 milliseconds and 1 minute simulation time = 1 hours real world time.
+ *          Simulation run-time is set at 3 hours for 20 aircrafts as default. These parameters can be changed at runtime with "-t" and "-n".
+ *          The simulation time resolution is 1 milliseconds and 1 hour is SIMULATION_FACTOR milliseconds of simulation time.
+ *          By default the simulation runs on the discrete event engine and finishes as fast as the events can be
+ *          processed. Pass "-r" to pace the services against the wall clock, the fleet is then stepped by a
+ *          fixed size worker pool ("-w"). The pace is set with "-x" in simulated seconds per wall second,
+ *          60 by default (1 hour = 1 minute), "-x max" runs the services back to back on a virtual clock.
+ *          A scenario file ("-i") sets the fleet, company specifications, chargers and fault model in one place.
+ *          Runs on the event engine can write checkpoints ("-k") and be resumed or forked into what-if branches
+ *          from one ("-R"). With "-V" the fleet flies between a network of vertiports, each with its own chargers,
+ *          simulated as parallel partitions of the event engine.
  * @author  Deepak E Kapure
  * @date    07-02-2025 
  * 
  */
-#include "../includes/definitions.hpp"
+#include "../includes/sim_context.hpp"
 #include "../includes/ac_simul.hpp"
+#include "../includes/event_engine.hpp"
+#include "../includes/batch.hpp"
+#include "../includes/sweep.hpp"
+#include "../includes/scenario.hpp"
+#include "../includes/checkpoint.hpp"
+#include "../includes/network.hpp"
+#include "../includes/instrument.hpp"
+#include "../includes/timer.hpp"
+#include <cstring>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 /**
- * @brief Aircraft parameters and log file literals
+ * @brief Log file literals
  * 
  */
 const string log_file = "evtol_sim_log.txt";
-const string base_log_header = " Aircraft_num Company Status Flight_time Miles_travelled Battery_soc Charger_id Charge_time Fault_count Charge_sessions ";
-static _ac_map paramter_map = {
-    { ALPHA,   {120, 320000, 60, 1600, 4} },
-    { BRAVO,   {100, 100000, 20, 1500, 5} },
-    { CHARLIE, {160, 220000, 80, 2200, 3}},
-    { DELTA,   {90, 120000, 62, 800, 2} },
-    { ECHO,    {30, 150000, 30, 5800, 2} }
-};
-static _prob_map probablity_map = {
-    { ALPHA,   0.25 },
-    { BRAVO,   0.10 },
-    { CHARLIE, 0.05 },
-    { DELTA,   0.22 },
-    { ECHO,    0.61 }
-};
-
-
-int main() {
+const string fdr_file = "evtol_sim_fdr.bin";
+const string batch_file = "evtol_sim_batch.txt";
+const string sweep_file = "evtol_sim_sweep.csv";
+const string ckpt_file = "evtol_sim_ckpt.bin";
+
+
+/**
+ * @brief Prints the command line usage.
+ *
+ * @param prog Program name.
+ *
+ * @return None
+ */
+static void print_usage(const char *prog) {
+    cout << "Usage: " << prog << " [-i scenario] [-n aircrafts] [-t hours] [-c chargers] [-p fifo|scf|pax] [-f text|bin|delta] [-s seed] [-b replications] [-S sweep] [-d] [-l seconds] [-k hours] [-R checkpoint] [-V sites[:miles]] [-r] [-x scale|max] [-w workers]" << endl;
+    cout << "  -i  load a scenario file of key = value lines: fleet, company specifications, chargers, faults, downtime," << endl;
+    cout << "      recorder interval and an optional fleet manifest, see README. Options after -i override it" << endl;
+    cout << "  -n  number of aircrafts in the fleet (default " << DEFAULT_AIRCRAFTS << ", minimum " << MIN_AIRCRAFTS << ")" << endl;
+    cout << "  -t  simulated hours (default " << DEFAULT_SIMULATION_HRS << ")" << endl;
+    cout << "  -c  number of chargers (default " << DEFAULT_CHARGERS << ")" << endl;
+    cout << "  -p  charger dispatch policy: fifo (default), scf shortest charge first, pax most passengers first" << endl;
+    cout << "  -f  flight data recorder format: text (default), bin binary columnar, delta binary with delta encoded counters" << endl;
+    cout << "  -s  master seed, the same seed gives the same fleet, faults and results (default random)" << endl;
+    cout << "  -b  run a batch of independently seeded replications on -w threads and summarize the results" << endl;
+    cout << "  -S  sweep the cartesian product of key=values entries separated by ';', values are a comma list or start:end[:step]" << endl;
+    cout << "      keys: alpha bravo charlie delta echo (aircrafts per company), chargers, fault (fault probability scale)," << endl;
+    cout << "      downtime (hours), soc (charge threshold %). Each point runs -b replications (default 1)" << endl;
+    cout << "  -d  debug, dump the whole fault schedule to the console and the input log (faults are otherwise drawn on demand)" << endl;
+    cout << "  -l  print live per company statistics and instrumentation every given wall seconds while the run is in progress" << endl;
+    cout << "  -k  write a checkpoint of the complete simulation state to " << ckpt_file << " every given simulated hours" << endl;
+    cout << "  -R  resume from a checkpoint, bit exact unless options after -R change chargers, fault, downtime, soc or seed." << endl;
+    cout << "      With -b or -S every replication and point is a what-if branch forked from the checkpoint" << endl;
+    cout << "  -V  fly legs between a grid of vertiports spaced miles apart (default " << DEFAULT_SITE_MILES << "), each with -c chargers." << endl;
+    cout << "      Sites run as parallel partitions on -w threads, the results don't depend on the thread count" << endl;
+    cout << "  -r  pace the simulation against the wall clock" << endl;
+    cout << "  -x  time scale of -r in simulated seconds per wall second, implies -r (default " << DEFAULT_TIME_SCALE << ", 1 hour = 1 minute)," << endl;
+    cout << "      1 runs in real time, max runs as fast as possible on a virtual clock" << endl;
+    cout << "  -w  worker threads stepping the fleet with -r or running the vertiports with -V (default " << default_worker_count() << ")" << endl;
+}
+
+/**
+ * @brief State of the live statistics monitor thread.
+ *
+ * @var lock Protects stop.
+ * @var cv Wakes the monitor early when the run ends.
+ * @var stop Set when the run has ended.
+ */
+typedef struct LIVE_MONITOR {
+    mutex lock;
+    condition_variable cv;
+    bool stop;
+} _live_monitor;
+
+/**
+ * @brief Prints a live statistics and instrumentation report every cfg.live_interval
+ *        wall seconds until stopped. Only reads snapshots, the simulation is never paused.
+ *
+ * @param ctx Pointer to the simulation context.
+ * @param mon Pointer to the monitor state.
+ *
+ * @return None
+ */
+static void live_monitor(_sim_context *ctx, _live_monitor *mon) {
+    duration<double> interval(ctx->cfg.live_interval);
+    unique_lock<mutex> guard(mon->lock);
+    while(!mon->cv.wait_for(guard, interval, [mon] { return mon->stop; })) {
+        live_report(ctx, cout);
+        INSTR_REPORT(cout);
+    }
+}
+
+/**
+ * @brief Parses the command line into a simulation configuration.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @param cfg Pointer to the configuration to fill.
+ * @param sweep Pointer to the sweep spec to fill, left empty without "-S".
+ * @param sc Pointer to the scenario to fill, the built-in companies without "-i".
+ * @param resume Filled with the checkpoint given with "-R", left empty without it.
+ * @param err Filled with the reason if a scenario file or checkpoint is invalid.
+ *
+ * @return True if all arguments were valid.
+ */
+static bool parse_args(int argc, char *argv[], _sim_config *cfg, _sweep_spec *sweep, _scenario *sc, vector<char> *resume, string *err) {
+    bool ret = true;
+    default_sim_config(cfg);
+    init_scenario(sc);
+    cfg->seed = ((uint64_t)random_device{}() << 32) | random_device{}();
+    for(int i=1; (i<argc) && ret; i++) {
+        if((strcmp(argv[i], "-i") == 0) && (i+1 < argc)) {
+            ret = load_scenario(argv[++i], cfg, sc, err);
+        } else if((strcmp(argv[i], "-R") == 0) && (i+1 < argc)) {
+            milliseconds at;
+            string path = argv[++i];
+            ret = read_checkpoint_file(path, resume, err) && read_checkpoint_config(*resume, cfg, &at, err);
+            if(!ret && (err->find(path) != 0)) {
+                *err = path + ": " + *err;
+            }
+        } else if((strcmp(argv[i], "-k") == 0) && (i+1 < argc)) {
+            cfg->checkpoint_hours = atof(argv[++i]);
+            ret = (cfg->checkpoint_hours > 0);
+        } else if((strcmp(argv[i], "-V") == 0) && (i+1 < argc)) {
+            char *end;
+            cfg->sites = (int)strtol(argv[++i], &end, 10);
+            if(*end == ':') {
+                cfg->site_miles = strtod(end + 1, &end);
+            }
+            ret = (*end == '\0') && (cfg->sites > 0) && (cfg->sites <= MAX_SITES) && (cfg->site_miles > 0);
+        } else if(strcmp(argv[i], "-r") == 0) {
+            cfg->realtime = true;
+        } else if(strcmp(argv[i], "-d") == 0) {
+            cfg->dump_faults = true;
+        } else if((strcmp(argv[i], "-x") == 0) && (i+1 < argc)) {
+            cfg->realtime = true;
+            if(strcmp(argv[++i], "max") == 0) {
+                cfg->time_scale = TIME_SCALE_MAX;
+            } else {
+                cfg->time_scale = atof(argv[i]);
+                ret = (cfg->time_scale > 0);
+            }
+        } else if((strcmp(argv[i], "-n") == 0) && (i+1 < argc)) {
+            cfg->aircrafts = atoi(argv[++i]);
+            cfg->manifest = nullptr;                            // fleet size replaces a manifest
+            ret = (cfg->aircrafts > 0);
+        } else if((strcmp(argv[i], "-w") == 0) && (i+1 < argc)) {
+            cfg->workers = atoi(argv[++i]);
+            ret = (cfg->workers > 0);
+        } else if((strcmp(argv[i], "-c") == 0) && (i+1 < argc)) {
+            cfg->chargers = atoi(argv[++i]);
+            ret = (cfg->chargers > 0);
+        } else if((strcmp(argv[i], "-p") == 0) && (i+1 < argc)) {
+            i++;
+            if(strcmp(argv[i], "fifo") == 0) {
+                cfg->policy = DISPATCH_FIFO;
+            } else if(strcmp(argv[i], "scf") == 0) {
+                cfg->policy = DISPATCH_SHORTEST_CHARGE;
+            } else if(strcmp(argv[i], "pax") == 0) {
+                cfg->policy = DISPATCH_PASSENGERS;
+            } else {
+                ret = false;
+            }
+        } else if((strcmp(argv[i], "-f") == 0) && (i+1 < argc)) {
+            i++;
+            if(strcmp(argv[i], "text") == 0) {
+                cfg->fdr_format = FDR_TEXT;
+            } else if(strcmp(argv[i], "bin") == 0) {
+                cfg->fdr_format = FDR_BINARY;
+            } else if(strcmp(argv[i], "delta") == 0) {
+                cfg->fdr_format = FDR_BINARY_DELTA;
+            } else {
+                ret = false;
+            }
+        } else if((strcmp(argv[i], "-s") == 0) && (i+1 < argc)) {
+            char *end;
+            cfg->seed = strtoull(argv[++i], &end, 0);
+            ret = (*end == '\0');
+        } else if((strcmp(argv[i], "-b") == 0) && (i+1 < argc)) {
+            cfg->replications = atoi(argv[++i]);
+            ret = (cfg->replications > 0);
+        } else if((strcmp(argv[i], "-l") == 0) && (i+1 < argc)) {
+            cfg->live_interval = atof(argv[++i]);
+            ret = (cfg->live_interval > 0);
+        } else if((strcmp(argv[i], "-S") == 0) && (i+1 < argc)) {
+            ret = parse_sweep_spec(argv[++i], sweep);
+        } else if((strcmp(argv[i], "-t") == 0) && (i+1 < argc)) {
+            cfg->sim_hours = atof(argv[++i]);
+            ret = (cfg->sim_hours > 0);
+        } else {
+            ret = false;
+        }
+    }
+    return ret;
+}
+
+int main(int argc, char *argv[]) {
+
+    _sim_config cfg;
+    _sweep_spec sweep;
+    _scenario sc;                                               // company specifications and fleet manifest
+    vector<char> resume;                                        // checkpoint to resume or fork from
+    string err;
+    if(!parse_args(argc, argv, &cfg, &sweep, &sc, &resume, &err)) {
+        if(err.empty()) {
+            print_usage(argv[0]);
+        } else {
+            cout << "Input error: " << err << endl;
+        }
+        return 1;
+    }
+    cfg.checkpoint_file = ckpt_file.c_str();
+    bool swept_mix = false;
+    for(int c=0; c<TOTAL_CATEGORIES; c++) {
+        swept_mix |= !sweep.values[c].empty();
+    }
+    if(cfg.realtime && ((cfg.checkpoint_hours > 0) || !resume.empty())) {
+        cout << "Checkpoints need the event engine, -k and -R can't be used with -r or -x" << endl;
+        return 1;
+    }
+    if((cfg.sites > 0) && (cfg.realtime || (cfg.checkpoint_hours > 0) || !resume.empty())) {
+        cout << "The vertiport network runs on the event engine without checkpoints, -V can't be used with -r, -x, -k or -R" << endl;
+        return 1;
+    }
+    if(!resume.empty() && swept_mix) {
+        cout << "The fleet of a resumed run comes from the checkpoint, its mix can't be swept" << endl;
+        return 1;
+    }
+    const vector<char> *branch_from = resume.empty() ? nullptr : &resume;
+
+    vector<_sim_config> points;
+    build_sweep_points(cfg, sweep, &points);
+    if((points.size() > 1) || (cfg.replications > 0)) {
+        INSTR_ENABLE(false);                                    // replications are measured by their throughput
+    }
+    if(points.empty()) {
+        cout << "Sweep has no point with aircrafts" << endl;
+        return 1;
+    }
+    if(points.size() > 1) {
+        int reps = max(cfg.replications, 1);
+        cout << "--------Starting eVtol sweep--------" << endl;
+        cout << "Running " << points.size() << " points x " << reps << " replications for " << cfg.sim_hours
+             << " hours on " << cfg.workers << " threads, seed: " << cfg.seed << endl;
+        vector<_batch_result> res;
+        run_batch_points(points, reps, &sc.params, &sc.probs, &res, branch_from);
+        ofstream sp = open_log_file(sweep_file);
+        write_sweep_results(points, res, sp);
+        close_file(sp);
+        double seconds = res.empty() ? 0.0 : res[0].seconds;
+        cout << "Sweep_Results: " << points.size() * reps << " runs, " << seconds << " s, "
+             << ((seconds > 0) ? (points.size() * reps / seconds) : 0.0) << " runs/s" << endl;
+        cout << "\nSweep results recorded in file: " << sweep_file << endl;
+        return 0;
+    }
+    cfg = points[0];                                            // without -S or for a single point spec
+
+    if(cfg.replications > 0) {
+        cout << "--------Starting eVtol batch--------" << endl;
+        cout << "Running " << cfg.replications << " replications of " << cfg.aircrafts << " aircrafts for " << cfg.sim_hours
+             << " hours on " << cfg.workers << " threads, seed: " << cfg.seed << endl;
+        _batch_result res;
+        if(branch_from) {
+            vector<_batch_result> all;
+            cout << "Forking every replication from the checkpoint" << endl;
+            run_batch_points(vector<_sim_config>(1, cfg), cfg.replications, &sc.params, &sc.probs, &all, branch_from);
+            res = all[0];
+        } else {
+            run_batch(cfg, &sc.params, &sc.probs, &res);
+        }
+        ofstream bp = open_log_file(batch_file);
+        write_batch_results(&res, cout);
+        write_batch_results(&res, bp);
+        close_file(bp);
+        cout << "\nBatch results recorded in file: " << batch_file << endl;
+        return 0;
+    }
 
     // Shared global variables  
     ofstream fp;                                                // log file pointer
-    _fault_map fault_queue;                                     // fault service queue
-    charger global_charger;                                     // charger object TO DO: For stroing charger info
-    queue<_c_queue_entry*> charger_queue;                       // charging queue
-    vector<thread> threadpool;                                  // threads for spawning 
-    aircraft *aircraft_array[TOTAL_AIRCRAFTS];                  // global aircraft object array
+    ofstream fdr_fp;                                            // binary flight data recorder file
+    ofstream *fdr_out = &fp;                                    // flight data goes to the log file in text format
+    _sim_context ctx;                                           // fleet, signals, chargers, charge queue and faults
+    _network net;                                               // vertiports with -V
+
+    ckpt_reader resume_in(resume.data(), resume.size());      // restored context, then the engine state
+    milliseconds resume_at(0);
+    milliseconds resume_end(0);
+    const _sim_config *what_if = nullptr;
+    _sim_config saved = cfg;
 
     cout << "--------Starting eVtol simulation--------" << endl;
-    cout << "Spawning " << TOTAL_AIRCRAFTS << " aircrafts" << endl;
+    if(branch_from) {
+        milliseconds at;
+        read_checkpoint_config(resume, &saved, &at, &err);
+        if(!restore_sim_context(&ctx, &resume_in, cfg, &resume_at, &resume_end)) {
+            cout << "Checkpoint is damaged" << endl;
+            return 1;
+        }
+        what_if = is_what_if(saved, cfg) ? &cfg : nullptr;
+        cout << "Resuming " << ctx.cfg.aircrafts << " aircrafts, " << ctx.chargers.size() << " chargers at "
+             << resume_at.count() * SIM_MS_TO_HOURS << " hours" << (what_if ? " as a what-if branch" : "") << endl;
+        cout << "Seed: " << cfg.seed << endl;
+    } else {
+        init_sim_context(&ctx, cfg);
+        if(ctx.cfg.sites > 0) {
+            cout << "Spawning " << ctx.cfg.aircrafts << " aircrafts on " << ctx.cfg.sites << " vertiports, " << ctx.chargers.size()
+                 << " chargers each" << endl;
+        } else {
+            cout << "Spawning " << ctx.cfg.aircrafts << " aircrafts, " << ctx.chargers.size() << " chargers" << endl;
+        }
+        cout << "Seed: " << ctx.cfg.seed << endl;
 
-    // Create aircraft objects 
-    create_aircrafts(aircraft_array, TOTAL_AIRCRAFTS, &paramter_map, TOTAL_CATEGORIES);
-    // Pre-calculate faults
-    fault_injection(&probablity_map, aircraft_array, TOTAL_AIRCRAFTS, &fault_queue);
+        // Create aircraft objects 
+        create_aircrafts(&ctx, &sc.params, TOTAL_CATEGORIES);
+        // Arm the fault processes, faults are drawn on demand
+        fault_injection(&sc.probs, &ctx);
+    }
     
-    cout << "Faults at --" << endl;
-    for(auto i: fault_queue) {
-        cout << "Aircraft number: " << i.second << ", time: " << (i.first).count() << endl;
+    if(ctx.cfg.dump_faults) {
+        vector<_fault_event> all;
+        ctx.faults.dump(&all);
+        cout << "Faults at --" << endl;
+        for(auto i: all) {
+            cout << "Aircraft number: " << i.ac_num << ", time: " << (i.time).count() << endl;
+        }
     }
 
-    // Spawn threads
-    spawn_threads(&threadpool, TOTAL_AIRCRAFTS, aircraft_array, &charger_queue);
-
     // open log file for dumping flight data and insert data header
     fp = open_log_file(log_file);
-    string extended_header = "Timestamp";
-    for(auto ac=0; ac<TOTAL_AIRCRAFTS; ac++) {
-        extended_header.append(base_log_header);
+    if(ctx.cfg.fdr_format != FDR_TEXT) {
+        fdr_fp = open_log_file(fdr_file, true);
+        fdr_out = &fdr_fp;
     }
-    write_to_file(fp, extended_header);
-    
-    // Initialize global timer
-    init_Timer();
+    write_fdr_header(&ctx, *fdr_out);
+    start_fdr_writer(&ctx, *fdr_out);                           // flight data is written on its own thread
 
-    // Prepare best-effort loop for simulation
-    int total_time = SIMULATION_TIME_HRS * SIMULATION_FACTOR;
-    
-    cout << "Simulating for " << SIMULATION_TIME_HRS << " hours." << " Time: " << SIMULATION_TIME_HRS << " minutes (" << total_time << ")"<< endl;
-    cout << "All fights airborne!" << endl;
-    
-    milliseconds total_sim_time(total_time), curr(0);
-    while(curr < total_sim_time) {
-        // Call fault handling service to inject faults  
-        fault_service(&fault_queue);
-        // Service to handle charging for aircrafts
-        charging_service(&global_charger, &charger_queue);
-        // Flight Data Recorder service to log aircraft info
-        data_recorder_service(aircraft_array, TOTAL_AIRCRAFTS, fp);
-        // Update simulation counter
-        update_Timer();
-        get_counter_val(&curr);
-    }
-
-    // Terminate threads
-    cout << "Terminating all fight sims.." << endl;
-    set_terminate_sig(true);
-    for(auto &th: threadpool) {
-        th.join();
-    }
-
-    for(auto a: aircraft_array) {
+    long total_time = ctx.cfg.sim_hours * SIMULATION_FACTOR;
+    milliseconds total_sim_time(total_time);
+
+    _live_monitor mon;
+    mon.stop = false;
+    thread monitor;
+    if(ctx.cfg.live_interval > 0) {
+        monitor = thread(live_monitor, &ctx, &mon);            // live statistics while the run is in progress
+    }
+
+    if(ctx.cfg.sites > 0) {
+        int partitions = min(ctx.cfg.workers, ctx.cfg.sites);
+        worker_pool pool(partitions);
+        cout << "Simulating for " << ctx.cfg.sim_hours << " hours on the event engine, " << ctx.cfg.sites << " vertiports in "
+             << partitions << " partitions (" << total_time << ")" << endl;
+        cout << "All fights airborne!" << endl;
+        network_simulation(&ctx, &net, total_sim_time, (partitions > 1) ? &pool : nullptr);
+        cout << "Synchronization windows: " << net.windows << " of " << net.lookahead.count() << " msec, aircraft handed over: "
+             << net.transfers << endl;
+    } else if(!ctx.cfg.realtime) {
+        cout << "Simulating for " << ctx.cfg.sim_hours << " hours on the event engine (" << total_time << ")" << endl;
+        if(branch_from) {
+            if(!des_resume(&ctx, &resume_in, resume_at, resume_end, what_if)) {
+                cout << "Checkpoint engine state is damaged, nothing was simulated" << endl;
+            }
+        } else {
+            cout << "All fights airborne!" << endl;
+            des_simulation(&ctx, total_sim_time);
+        }
+    } else {
+        // Start the worker pool, thread count does not depend on the fleet size
+        worker_pool pool(ctx.cfg.workers);
+        cout << "Stepping fleet on " << pool.size() << " worker threads" << endl;
+        launch_fleet(&ctx);
+
+        // Initialize global timer, the clock runs at time_scale or free runs
+        double rate = ctx.cfg.time_scale * SIMULATION_FACTOR / HOUR_MSEC;
+        init_Timer(rate);
+
+        // Prepare best-effort loop for simulation
+        if(ctx.cfg.time_scale > 0) {
+            cout << "Simulating for " << ctx.cfg.sim_hours << " hours at " << ctx.cfg.time_scale << "x. Time: "
+                 << ctx.cfg.sim_hours * HOUR_MSEC / (ctx.cfg.time_scale * 1000) << " seconds (" << total_time << ")" << endl;
+        } else {
+            cout << "Simulating for " << ctx.cfg.sim_hours << " hours as fast as possible (" << total_time << ")" << endl;
+        }
+        cout << "All fights airborne!" << endl;
+
+        milliseconds curr(0);
+        bool lagging = false;
+        _timer_drift drift;
+        while(curr < total_sim_time) {
+            // Step the fleet through the aircraft state machine
+            simulation_service(&pool, &ctx);
+            // Call fault handling service to inject faults  
+            fault_service(&ctx);
+            // Service to handle charging for aircrafts
+            charging_service(&ctx);
+            // Flight Data Recorder service to log aircraft info
+            data_recorder_service(&ctx);
+            // Sleep until the next service is due, then update simulation counter
+            timer_wait(total_sim_time);
+            update_Timer();
+            get_counter_val(&curr);
+            if(!lagging) {
+                get_timer_drift(&drift);
+                if(drift.lag > milliseconds(DRIFT_WARN_TICKS * SERVICE_INTERVAL)) {
+                    lagging = true;
+                    cout << "Warning: host can't keep up with " << ctx.cfg.time_scale << "x, fleet is " << drift.lag.count()
+                         << " msec behind the clock at " << curr.count() << endl;
+                }
+            }
+        }
+        get_timer_drift(&drift);
+        double achieved = drift.achieved * HOUR_MSEC / SIMULATION_FACTOR;
+        cout << "Time scale requested: ";
+        if(ctx.cfg.time_scale > 0) {
+            cout << ctx.cfg.time_scale << "x";
+        } else {
+            cout << "max";
+        }
+        cout << ", achieved: " << achieved << "x, wall: " << drift.wall_ms / 1000 << " s, simulated: "
+             << drift.advanced.count() * SIM_MS_TO_HOURS << " of " << ctx.cfg.sim_hours << " hours, max lag: "
+             << drift.max_lag.count() << " msec" << endl;
+
+        // Terminate fleet stepping, pool threads are joined when it goes out of scope
+        cout << "Terminating all fight sims.." << endl;
+        set_terminate_sig(&ctx, true);
+    }
+
+    if(monitor.joinable()) {
+        {
+            lock_guard<mutex> guard(mon.lock);
+            mon.stop = true;
+        }
+        mon.cv.notify_one();
+        monitor.join();
+    }
+    finish_live_stats(&ctx);                                    // book the segments still open at the end
+    if(ctx.cfg.live_interval > 0) {
+        live_report(&ctx, cout);
+    }
+
+    for(auto a: ctx.fleet) {
         cout << "Aircraft: " << a->get_ac_num() << " -- flight time: " << a->get_flight_time() << \
         " hours, miles: " << a->get_miles() << ", faults: " << a->get_fault_count() << endl;  
     }
 
-    sim_analysis(aircraft_array, TOTAL_AIRCRAFTS, TOTAL_CATEGORIES, fp);
-    cout << "\nFlight data recorded in file: " << log_file << endl;
+    stop_fdr_writer(&ctx);                                      // drain pending samples before the analysis is appended
+    cout << "Flight data samples written: " << ctx.fdr.get_written() << ", dropped: " << ctx.fdr.get_dropped() << \
+    ", late: " << ctx.fdr.get_late() << endl;
+
+    sim_analysis(&ctx, TOTAL_CATEGORIES, fp);
+    if(ctx.cfg.sites > 0) {
+        network_analysis(&net, fp);
+    }
+    INSTR_REPORT(cout);
+    cout << "\nFlight data recorded in file: " << ((ctx.cfg.fdr_format != FDR_TEXT) ? fdr_file : log_file) << endl;
     
     // Executing exit sequence
+    close_file(fdr_fp);
     close_file(fp);
-    delete_aircrafts(aircraft_array, TOTAL_AIRCRAFTS);
+    delete_aircrafts(&ctx);
 
     cout << "-----------End of simulation----------" << endl;
     
     return 0;
-}
\ No newline at end of file
+}
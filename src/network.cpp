@@ -0,0 +1,470 @@
+/**
+ * @brief   Vertiport Network file
+ * @details This file contains the multi-vertiport network model for the eVtol simulation problem from Joby Avation.
+ *          Sites sit on a square grid, each with its own charger pool, charge queue and event queue. Flights
+ *          are legs between sites: on take off an aircraft picks a destination within its range at random,
+ *          the leg uses the distance times the company energy use and takes the distance over its speed, and
+ *          on landing the aircraft recharges the energy of the leg at the destination. Sites run as parallel
+ *          partitions of the event engine, synchronized at window boundaries one lookahead apart.
+ *
+ * @author  Deepak E Kapure
+ * @date    07-02-2025
+ *
+ */
+
+#include "../includes/network.hpp"
+#include "../includes/instrument.hpp"
+#include <algorithm>
+#include <sstream>
+#include <new>
+
+/**
+ * @brief Pushes a new event to the event queue of a site.
+ *
+ * @param v Pointer to the site.
+ * @param t Event time.
+ * @param type Event type.
+ * @param ac Aircraft number.
+ * @param epoch Aircraft epoch (-1 for events that are always processed).
+ *
+ * @return None
+ */
+static void schedule_site_event(_vertiport *v, milliseconds t, _event_type type, int ac, int epoch) {
+    _sim_event ev = {t, v->seq++, type, ac, epoch};
+    v->events.push_back(ev);
+    push_heap(v->events.begin(), v->events.end(), _event_later());
+}
+
+/**
+ * @brief Queues the next fault of an aircraft at the site that owns it.
+ *
+ * @param net Pointer to the network.
+ * @param v Pointer to the site.
+ * @param ac Aircraft number.
+ *
+ * @return None
+ */
+static void schedule_fault(_network *net, _vertiport *v, int ac) {
+    milliseconds t;
+    if(net->ctx->faults.source_next(ac, &t)) {
+        schedule_site_event(v, t, EV_FAULT, ac, -1);
+    }
+}
+
+/**
+ * @brief Starts the next flight leg of an aircraft taking off from a site. The destination
+ *        is drawn from the sites within range of its company, without one the aircraft
+ *        flies a local flight down to the soc threshold and lands back at the site.
+ *
+ * @param net Pointer to the network.
+ * @param v Pointer to the site of take off.
+ * @param ac Aircraft number.
+ *
+ * @return None
+ */
+static void depart(_network *net, _vertiport *v, int ac) {
+    _sim_context *ctx = net->ctx;
+    aircraft *plane = ctx->fleet[ac];
+    _ac_info *info = plane->get_ac_info();
+    double reserve = (100 - ctx->cfg.soc_threshold) * ctx->store.cap_per_soc[ac];    // Wh down to the soc threshold
+    double full_ms = info->toc_hrs * SIMULATION_FACTOR / 100 / ctx->cfg.charger_power;
+    size_t key = (size_t)v->id * TOTAL_CATEGORIES + info->company;
+    size_t first = net->reach_begin[key];
+    size_t count = net->reach_begin[key + 1] - first;
+    v->departures++;
+    if(count == 0) {
+        plane->set_leg(reserve, (int)full_ms);
+        return;
+    }
+    int dest = net->reach[first + net->route[ac].below((uint32_t)count)];
+    double miles = hypot(net->sites[dest].x - v->x, net->sites[dest].y - v->y);
+    double energy = miles * info->energy_use;
+    plane->set_leg(energy, (int)ceil(full_ms * energy / reserve));
+    net->site[ac] = dest;
+    v->outbox.push_back(ac);
+}
+
+/**
+ * @brief Runs the aircraft state machine for the time elapsed since its last update.
+ *        Charge requests go to the queue of the site.
+ *
+ * @param net Pointer to the network.
+ * @param v Pointer to the site that owns the aircraft.
+ * @param ac Aircraft number.
+ * @param now Current simulation time.
+ *
+ * @return None
+ */
+static void advance_site_aircraft(_network *net, _vertiport *v, int ac, milliseconds now) {
+    _sim_context *ctx = net->ctx;
+    milliseconds dt = now - net->last_update[ac];
+    net->last_update[ac] = now;
+    ctx->fleet[ac]->update_ac_stats(dt);
+    ctx->fleet[ac]->state_machine(dt, &ctx->mailbox[ac], &v->charge_queue, &ctx->live);
+}
+
+/**
+ * @brief Invalidates pending events of an aircraft and schedules the next one on the
+ *        site based on its state at time t.
+ *
+ * @param net Pointer to the network.
+ * @param v Pointer to the site that owns the aircraft.
+ * @param ac Aircraft number.
+ * @param t Time the aircraft state is at.
+ *
+ * @return None
+ */
+static void reschedule_site_aircraft(_network *net, _vertiport *v, int ac, milliseconds t) {
+    aircraft *plane = net->ctx->fleet[ac];
+    net->epoch[ac]++;
+    switch(plane->get_ac_status()) {
+        case IN_FLIGHT:
+            schedule_site_event(v, t + plane->time_to_soc_threshold(), EV_BATTERY_DEPLETED, ac, net->epoch[ac]);
+            break;
+        case UNDER_MAINTENANCE:
+            schedule_site_event(v, t + milliseconds(max(1L, (long)ceil(plane->get_downtime_limit() - plane->get_downtime()))),
+                                EV_MAINTENANCE_DONE, ac, net->epoch[ac]);
+            break;
+        case IN_CHARGE_QUEUE:                   // charger events are scheduled by the charging step
+        case CHARGING:
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Advances an aircraft to the current time and reschedules it if its state changed.
+ *        A leg ends when the aircraft joins the charge queue from flight, the next one
+ *        starts when it leaves the charger.
+ *
+ * @param net Pointer to the network.
+ * @param v Pointer to the site that owns the aircraft.
+ * @param ac Aircraft number.
+ * @param now Current simulation time.
+ *
+ * @return True if the aircraft changed state.
+ */
+static bool step_site_aircraft(_network *net, _vertiport *v, int ac, milliseconds now) {
+    aircraft *plane = net->ctx->fleet[ac];
+    int prev = plane->get_ac_status();
+    advance_site_aircraft(net, v, ac, now);
+    int status = plane->get_ac_status();
+    if(prev == status) {
+        return false;
+    }
+    if((prev == IN_FLIGHT) && (status == IN_CHARGE_QUEUE)) {
+        v->landings++;
+    } else if((prev == CHARGING) && (status == IN_FLIGHT)) {
+        depart(net, v, ac);
+    }
+    reschedule_site_aircraft(net, v, ac, now);
+    return true;
+}
+
+/**
+ * @brief Advances the chargers of a site to the current time, releases finished or
+ *        faulted sessions and assigns queued aircraft to every free charger.
+ *
+ * @param net Pointer to the network.
+ * @param v Pointer to the site.
+ * @param now Current simulation time.
+ *
+ * @return None
+ */
+static void service_site_chargers(_network *net, _vertiport *v, milliseconds now) {
+    _sim_context *ctx = net->ctx;
+    vector<int> &changed = v->changed;
+    changed.clear();
+    milliseconds elapsed = now - v->charger_clock;
+    v->charger_clock = now;
+    charging_update_pool(ctx, &v->chargers, &v->charge_queue, elapsed, &changed);
+
+    sort(changed.begin(), changed.end());
+    changed.erase(unique(changed.begin(), changed.end()), changed.end());
+    for(auto ac: changed) {
+        step_site_aircraft(net, v, ac, now);
+        int c_id = get_charge_sig(ctx, ac);
+        if(c_id > 0) {                          // newly assigned, schedule end of session
+            _c_live_info live = v->chargers.get_live(c_id);
+            schedule_site_event(v, now + milliseconds(live.c_time_left), EV_CHARGE_COMPLETE, ac, -1);
+        }
+    }
+    v->peak_waiting = max(v->peak_waiting, v->chargers.waiting_count());
+}
+
+/**
+ * @brief Processes the events of a site up to the end of a window. Aircraft that took off
+ *        for another site stay with it until then, their events are dropped at the end.
+ *        Only touches the site and the aircraft it owns, sites run in parallel.
+ *
+ * @param net Pointer to the network.
+ * @param v Pointer to the site.
+ * @param until End of the window, events at or after it are left for the next one.
+ *
+ * @return None
+ */
+static void run_site_window(_network *net, _vertiport *v, milliseconds until) {
+    _sim_context *ctx = net->ctx;
+    while(!v->events.empty() && (v->events.front().time < until)) {
+        _sim_event ev = v->events.front();
+        pop_heap(v->events.begin(), v->events.end(), _event_later());
+        v->events.pop_back();
+        if((ev.epoch >= 0) && (ev.epoch != net->epoch[ev.ac_num])) {
+            continue;                                   // stale event
+        }
+        milliseconds now = ev.time;
+        INSTR_SCOPE(PROBE_DES_EVENT);
+        switch(ev.type) {
+            case EV_FAULT:
+                step_site_aircraft(net, v, ev.ac_num, now);
+                post_fault(ctx, ev.ac_num);
+                advance_site_aircraft(net, v, ev.ac_num, now);
+                reschedule_site_aircraft(net, v, ev.ac_num, now);
+                ctx->faults.source_draw(ev.ac_num);
+                schedule_fault(net, v, ev.ac_num);
+                break;
+            case EV_BATTERY_DEPLETED:
+            case EV_MAINTENANCE_DONE:
+                if(!step_site_aircraft(net, v, ev.ac_num, now)) {
+                    reschedule_site_aircraft(net, v, ev.ac_num, now);  // charge queue full, retry
+                }
+                break;
+            case EV_CHARGE_COMPLETE:
+            default:
+                break;                                  // handled by the charging step below
+        }
+        service_site_chargers(net, v, now);
+    }
+    if(!v->outbox.empty()) {
+        int *site = net->site;
+        int id = v->id;
+        v->events.erase(remove_if(v->events.begin(), v->events.end(), [site, id](const _sim_event &ev) {
+            return site[ev.ac_num] != id;
+        }), v->events.end());
+        make_heap(v->events.begin(), v->events.end(), _event_later());
+    }
+}
+
+/**
+ * @brief Hands the aircraft that took off for another site in the last window to their
+ *        destination, in site and take off order so the result does not depend on the
+ *        partitioning. Their state is at their last update, every pending event is
+ *        scheduled from there and is not before the window boundary.
+ *
+ * @param net Pointer to the network.
+ *
+ * @return None
+ */
+static void hand_over(_network *net) {
+    for(auto &v: net->sites) {
+        for(auto ac: v.outbox) {
+            _vertiport *dest = &net->sites[net->site[ac]];
+            reschedule_site_aircraft(net, dest, ac, net->last_update[ac]);
+            schedule_fault(net, dest, ac);
+        }
+        net->transfers += v.outbox.size();
+        v.outbox.clear();
+    }
+}
+
+/**
+ * @brief Takes a flight data sample at a window boundary: every aircraft is advanced at
+ *        its site and the chargers of every site are serviced before the snapshot.
+ *
+ * @param net Pointer to the network.
+ * @param now Time of the sample.
+ *
+ * @return None
+ */
+static void sample_network(_network *net, milliseconds now) {
+    _sim_context *ctx = net->ctx;
+    for(int ac=0; ac<ctx->cfg.aircrafts; ac++) {
+        step_site_aircraft(net, &net->sites[net->site[ac]], ac, now);
+    }
+    for(auto &v: net->sites) {
+        service_site_chargers(net, &v, now);
+    }
+    record_flight_data(ctx, now);
+}
+
+/**
+ * @brief Builds the destinations within range of every company from every site, nearest
+ *        rows first. Only the grid cells within range are visited.
+ *
+ * @param net Pointer to the network, sites placed.
+ *
+ * @return None
+ */
+static void build_reach(_network *net) {
+    _sim_context *ctx = net->ctx;
+    int sites = (int)net->sites.size();
+    int rows = (sites + net->columns - 1) / net->columns;
+    net->reach.clear();
+    net->reach_begin.assign((size_t)sites * TOTAL_CATEGORIES + 1, 0);
+    for(int s=0; s<sites; s++) {
+        int cx = s % net->columns;
+        int cy = s / net->columns;
+        for(int c=0; c<TOTAL_CATEGORIES; c++) {
+            const _ac_spec &spec = ctx->store.spec[c];
+            double range = (100 - ctx->cfg.soc_threshold) * spec_cap_per_soc(spec) / spec.energy_use;
+            int cells = (int)min((double)max(rows, net->columns), floor(range / net->site_miles));
+            net->reach_begin[(size_t)s * TOTAL_CATEGORIES + c] = net->reach.size();
+            for(int y=max(0, cy - cells); y<=min(rows - 1, cy + cells); y++) {
+                for(int x=max(0, cx - cells); x<=min(net->columns - 1, cx + cells); x++) {
+                    int d = y * net->columns + x;
+                    if((d != s) && (d < sites) && (hypot(x - cx, y - cy) * net->site_miles <= range)) {
+                        net->reach.push_back(d);
+                    }
+                }
+            }
+        }
+    }
+    net->reach_begin.back() = net->reach.size();
+}
+
+/**
+ * @brief Sets up the network of a run: sites, their chargers and queues, the destinations
+ *        in range and the per aircraft state in the context arena. Aircraft are based
+ *        round robin on the sites.
+ *
+ * @param net Pointer to the network.
+ * @param ctx Pointer to the simulation context, fleet created and faults armed.
+ * @param end_time Total simulation time.
+ *
+ * @return None
+ */
+static void init_network(_network *net, _sim_context *ctx, milliseconds end_time) {
+    int size = ctx->cfg.aircrafts;
+    int sites = max(1, min(ctx->cfg.sites, MAX_SITES));
+    net->ctx = ctx;
+    if(net->sites.size() != (size_t)sites) {
+        net->sites = vector<_vertiport>(sites);
+    }
+    net->columns = (int)ceil(sqrt((double)sites));
+    net->site_miles = (ctx->cfg.site_miles > 0) ? ctx->cfg.site_miles : DEFAULT_SITE_MILES;
+    size_t based = (size_t)size / sites + 1;
+    for(int s=0; s<sites; s++) {
+        _vertiport *v = &net->sites[s];
+        v->id = s;
+        v->x = (s % net->columns) * net->site_miles;
+        v->y = (s / net->columns) * net->site_miles;
+        v->chargers.init(ctx->cfg.chargers, ctx->cfg.policy);
+        v->charge_queue.init(based * CHARGE_QUEUE_PER_AIRCRAFT);
+        v->events.clear();
+        v->events.reserve(2 * based + 2);
+        v->seq = 0;
+        v->charger_clock = milliseconds(0);
+        v->changed.clear();
+        v->changed.reserve(2 * (size_t)ctx->cfg.chargers + 1);
+        v->outbox.clear();
+        v->departures = 0;
+        v->landings = 0;
+        v->peak_waiting = 0;
+    }
+    build_reach(net);
+
+    int fastest = 1;
+    for(int c=0; c<TOTAL_CATEGORIES; c++) {
+        fastest = max(fastest, ctx->store.spec[c].speed);
+    }
+    long lookahead = (long)(net->site_miles / fastest * SIMULATION_FACTOR) - 1;      // less one msec for the rounding of flight times
+    net->lookahead = (sites > 1) ? milliseconds(max(1L, lookahead)) : end_time;
+    net->end_time = end_time;
+    net->windows = 0;
+    net->transfers = 0;
+
+    net->site = ctx->arena.alloc_array<int>(size);
+    net->route = ctx->arena.alloc_array<philox_rng>(size);
+    net->last_update = ctx->arena.alloc_array<milliseconds>(size);
+    net->epoch = ctx->arena.alloc_array<int>(size);
+    for(int ac=0; ac<size; ac++) {
+        net->site[ac] = ac % sites;
+        new (&net->route[ac]) philox_rng(ctx->cfg.seed, RNG_STREAM_ROUTE + ac);
+    }
+    fill(net->last_update, net->last_update + size, milliseconds(0));
+    fill(net->epoch, net->epoch + size, 0);
+}
+
+/**
+ * @brief Runs the simulation on a network of cfg.sites vertiports. Every window the sites
+ *        are split in contiguous partitions over the pool and each runs its events up to
+ *        the window end, then the aircraft that took off for another site are handed over.
+ *        Windows also end at flight data samples. Results don't depend on the number of
+ *        workers.
+ *
+ * @param ctx Pointer to the simulation context. Fleet, fault schedule and flight data recorder must be initialized.
+ * @param net Pointer to the network, filled for network_analysis().
+ * @param end_time Total simulation time.
+ * @param pool Worker pool running the partitions, nullptr to run the sites on the calling thread.
+ *
+ * @return None
+ */
+void network_simulation(_sim_context *ctx, _network *net, milliseconds end_time, worker_pool *pool) {
+    if(!ctx || !net) {
+        return;
+    }
+    init_network(net, ctx, end_time);
+    int size = ctx->cfg.aircrafts;
+    int sites = (int)net->sites.size();
+    for(int ac=0; ac<size; ac++) {                      // all flights airborne at t=0, from their home site
+        _vertiport *v = &net->sites[net->site[ac]];
+        ctx->fleet[ac]->set_status(IN_FLIGHT);
+        depart(net, v, ac);
+        reschedule_site_aircraft(net, v, ac, milliseconds(0));
+        schedule_fault(net, v, ac);
+    }
+
+    bool recorder = ctx->fdr.is_running();              // no samples without a recorder, e.g. batch replications
+    milliseconds interval(ctx->cfg.fdr_interval);
+    milliseconds next_sample = recorder ? interval : end_time;
+    milliseconds now(0);
+    while(now < end_time) {
+        milliseconds until = min(min(now + net->lookahead, next_sample), end_time);
+        auto partition = [net, until](int begin, int end) {
+            for(int s=begin; s<end; s++) {
+                run_site_window(net, &net->sites[s], until);
+            }
+        };
+        if(pool) {
+            pool->parallel_for(sites, partition);
+        } else {
+            partition(0, sites);
+        }
+        hand_over(net);
+        net->windows++;
+        now = until;
+        if(recorder && (now == next_sample) && (now < end_time)) {
+            sample_network(net, now);
+            next_sample += interval;
+        }
+    }
+    for(int ac=0; ac<size; ac++) {
+        step_site_aircraft(net, &net->sites[net->site[ac]], ac, end_time);
+    }
+}
+
+/**
+ * @brief Writes the per site results of a network run: flight legs started and ended,
+ *        charger usage and the longest charger queue.
+ *
+ * @param net Pointer to the network of a finished run.
+ * @param outfile Output file stream to write the results.
+ *
+ * @return None
+ */
+void network_analysis(_network *net, ofstream &outfile) {
+    ostringstream line;
+    line << "Vertiport_Results:\n";
+    line << "Sites: " << net->sites.size() << ", Spacing(miles): " << net->site_miles << ", Lookahead(msec): "
+         << net->lookahead.count() << ", Windows: " << net->windows << ", Transfers: " << net->transfers << "\n";
+    for(auto &v: net->sites) {
+        long use = 0;
+        for(_charger_id id=1; id<=v.chargers.size(); id++) {
+            use += v.chargers.get_use_time(id);
+        }
+        line << "Site_" << v.id << " (" << v.x << ", " << v.y << "): Departures: " << v.departures << ", Landings: "
+             << v.landings << ", Charger_use(hrs): " << use * SIM_MS_TO_HOURS << ", Peak_waiting: " << v.peak_waiting << "\n";
+    }
+    line << "\n";
+    write_to_file(outfile, line.str());
+}
@@ -0,0 +1,398 @@
+/**
+ * @brief   Scenario Loader file
+ * @details This file contains the scenario file loader for the eVtol simulation problem from Joby Avation.
+ *          A scenario is a text file of "key = value" lines ('#' starts a comment) that sets the fleet
+ *          composition, the company specifications, the chargers, the fault model, the maintenance downtime
+ *          and the flight data recorder interval, so scenarios can be versioned instead of patched in code.
+ *          An explicit fleet manifest, one company per aircraft, is memory mapped and scanned in place so
+ *          fleets of millions of aircraft load in a fraction of a second.
+ *
+ * @author  Deepak E Kapure
+ * @date    07-02-2025
+ *
+ */
+
+#include "../includes/scenario.hpp"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Fields of a company specification that a scenario can set
+typedef enum SPEC_FIELD {
+    SPEC_SPEED=0,
+    SPEC_BATTERY,
+    SPEC_CHARGE_TIME,
+    SPEC_ENERGY,
+    SPEC_PASSENGERS,
+    SPEC_FAULT,
+    TOTAL_SPEC_FIELDS
+} _spec_field;
+
+static const char *spec_keys[TOTAL_SPEC_FIELDS] = {
+    "speed", "battery", "charge_time", "energy", "passengers", "fault"
+};
+
+/**
+ * @brief Company names accepted in scenario keys and manifests, case insensitive.
+ *        "beta" is the display name of BRAVO.
+ */
+static const struct {
+    const char *name;
+    _ac_type company;
+} company_keys[] = {
+    { "alpha", ALPHA }, { "bravo", BRAVO }, { "beta", BRAVO }, { "charlie", CHARLIE },
+    { "delta", DELTA }, { "echo", ECHO }
+};
+
+/**
+ * @brief Looks up a company by name or by its number.
+ *
+ * @param s Start of the name, not terminated.
+ * @param n Length of the name.
+ *
+ * @return Company, or -1 if unknown.
+ */
+static int company_index(const char *s, size_t n) {
+    if((n == 1) && (s[0] >= '0') && (s[0] < '0' + TOTAL_CATEGORIES)) {
+        return s[0] - '0';
+    }
+    for(auto &k: company_keys) {
+        if((strlen(k.name) == n) && (strncasecmp(k.name, s, n) == 0)) {
+            return k.company;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Parses a number, the whole string must be consumed.
+ *
+ * @param s String to parse.
+ * @param v Filled with the value.
+ *
+ * @return True if s is a finite number.
+ */
+static bool parse_number(const string &s, double *v) {
+    char *end;
+    *v = strtod(s.c_str(), &end);
+    return !s.empty() && (*end == '\0') && isfinite(*v);
+}
+
+/**
+ * @brief Parses a whole number in [lo, hi].
+ *
+ * @param s String to parse.
+ * @param lo Lowest valid value.
+ * @param hi Highest valid value.
+ * @param v Filled with the value.
+ *
+ * @return True if valid.
+ */
+static bool parse_count(const string &s, double lo, double hi, int *v) {
+    double x;
+    if(!parse_number(s, &x) || (x != floor(x)) || (x < lo) || (x > hi)) {
+        return false;
+    }
+    *v = (int)x;
+    return true;
+}
+
+/**
+ * @brief Removes leading and trailing white space.
+ *
+ * @param s String to trim.
+ *
+ * @return Trimmed string.
+ */
+static string trim(const string &s) {
+    size_t b = s.find_first_not_of(" \t\r");
+    size_t e = s.find_last_not_of(" \t\r");
+    return (b == string::npos) ? string() : s.substr(b, e - b + 1);
+}
+
+/**
+ * @brief Fills a scenario with the built-in companies and no manifest.
+ *
+ * @param sc Pointer to the scenario.
+ *
+ * @return None
+ */
+void init_scenario(_scenario *sc) {
+    if(sc) {
+        sc->params = paramter_map;
+        sc->probs = probablity_map;
+        sc->manifest.clear();
+    }
+}
+
+/**
+ * @brief Sets one field of a company specification.
+ *
+ * @param sc Pointer to the scenario.
+ * @param c Company.
+ * @param field Field name.
+ * @param value Value string.
+ *
+ * @return True if the field and value were valid.
+ */
+static bool set_spec_field(_scenario *sc, int c, const string &field, const string &value) {
+    int f = 0;
+    for(; (f < TOTAL_SPEC_FIELDS) && (field != spec_keys[f]); f++);
+    vector<int> &para = sc->params[(_ac_type)c];
+    double x;
+    int n;
+    switch(f) {
+        case SPEC_SPEED:       return parse_count(value, 1, 1e6, &para[0]);
+        case SPEC_BATTERY:     return parse_count(value, 1, 1e9, &para[1]);
+        case SPEC_CHARGE_TIME:                                  // hours, stored as hours x 100
+            if(!parse_number(value, &x) || (x <= 0) || (x > 1e6)) {
+                return false;
+            }
+            para[2] = max(1, (int)lround(x * 100));
+            return true;
+        case SPEC_ENERGY:      return parse_count(value, 1, 1e6, &para[3]);
+        case SPEC_PASSENGERS:
+            if(!parse_count(value, 0, 1e4, &n)) {
+                return false;
+            }
+            para[4] = n;
+            return true;
+        case SPEC_FAULT:
+            if(!parse_number(value, &x) || (x < 0)) {
+                return false;
+            }
+            sc->probs[(_ac_type)c] = x;
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Applies one "key = value" entry of a scenario.
+ *
+ * @param key Key.
+ * @param value Value.
+ * @param dir Directory of the scenario file, relative manifest paths start here.
+ * @param cfg Pointer to the configuration.
+ * @param sc Pointer to the scenario.
+ * @param err Filled with the reason if the entry is invalid.
+ *
+ * @return True if the entry was valid.
+ */
+static bool apply_entry(const string &key, const string &value, const string &dir, _sim_config *cfg, _scenario *sc, string *err) {
+    double x;
+    size_t dot = key.find('.');
+    if(dot != string::npos) {                                   // <company>.<field>
+        int c = company_index(key.c_str(), dot);
+        if((c < 0) || !set_spec_field(sc, c, key.substr(dot + 1), value)) {
+            *err = "invalid company specification '" + key + "'";
+            return false;
+        }
+        return true;
+    }
+    int c = company_index(key.c_str(), key.size());
+    bool ok = true;
+    if((c >= 0) && (key.size() > 1)) {                          // aircraft of one company, fixes the mix
+        ok = parse_count(value, 0, 1e9, &cfg->mix[c]);
+    } else if(key == "aircrafts") {
+        ok = parse_count(value, 1, 1e9, &cfg->aircrafts);
+    } else if(key == "hours") {
+        ok = parse_number(value, &cfg->sim_hours) && (cfg->sim_hours > 0);
+    } else if(key == "chargers") {
+        ok = parse_count(value, 1, 1e9, &cfg->chargers);
+    } else if(key == "charger_power") {
+        ok = parse_number(value, &cfg->charger_power) && (cfg->charger_power > 0);
+    } else if(key == "policy") {
+        if(value == "fifo") {
+            cfg->policy = DISPATCH_FIFO;
+        } else if(value == "scf") {
+            cfg->policy = DISPATCH_SHORTEST_CHARGE;
+        } else if(value == "pax") {
+            cfg->policy = DISPATCH_PASSENGERS;
+        } else {
+            ok = false;
+        }
+    } else if(key == "seed") {
+        char *end;
+        cfg->seed = strtoull(value.c_str(), &end, 0);
+        ok = !value.empty() && (*end == '\0');
+    } else if(key == "fault_scale") {
+        ok = parse_number(value, &cfg->fault_scale) && (cfg->fault_scale >= 0);
+    } else if(key == "downtime") {
+        ok = parse_number(value, &cfg->downtime_hours) && (cfg->downtime_hours >= 0);
+    } else if(key == "soc") {
+        ok = parse_count(value, 0, 99, &cfg->soc_threshold);
+    } else if(key == "fdr_interval") {
+        ok = parse_number(value, &x) && (x >= 1) && (x == floor(x));
+        cfg->fdr_interval = ok ? (int)x : cfg->fdr_interval;
+    } else if(key == "sites") {
+        ok = parse_count(value, 0, MAX_SITES, &cfg->sites);
+    } else if(key == "site_miles") {
+        ok = parse_number(value, &cfg->site_miles) && (cfg->site_miles > 0);
+    } else if(key == "manifest") {
+        string path = ((value.size() > 0) && (value[0] != '/')) ? (dir + value) : value;
+        if(!load_fleet_manifest(path, &sc->manifest, err)) {
+            return false;
+        }
+        cfg->manifest = &sc->manifest;
+        cfg->aircrafts = (int)sc->manifest.size();
+    } else {
+        *err = "unknown key '" + key + "'";
+        return false;
+    }
+    if(!ok) {
+        *err = "invalid value '" + value + "' for '" + key + "'";
+    }
+    return ok;
+}
+
+/**
+ * @brief Loads a scenario file on top of a configuration. Keys:
+ *        aircrafts, hours, chargers, charger_power (charge rate multiplier), policy (fifo|scf|pax),
+ *        seed, fault_scale, downtime (hours), soc (charge threshold %), fdr_interval (msec),
+ *        sites (vertiports of the network model), site_miles (vertiport spacing), manifest (fleet manifest file), alpha..echo (aircraft per company, fixes the mix) and
+ *        <company>.speed|battery|charge_time|energy|passengers|fault for the company specifications.
+ *
+ * @param path Scenario file.
+ * @param cfg Pointer to the configuration, entries of the file replace its values.
+ * @param sc Pointer to the scenario, company specifications and manifest.
+ * @param err Filled with "file:line: reason" if the file is invalid.
+ *
+ * @return True if the whole file was valid.
+ */
+bool load_scenario(const string &path, _sim_config *cfg, _scenario *sc, string *err) {
+    ifstream in(path);
+    if(!in.is_open()) {
+        *err = path + ": cannot open";
+        return false;
+    }
+    size_t slash = path.rfind('/');
+    string dir = (slash == string::npos) ? string() : path.substr(0, slash + 1);
+    string line;
+    int num = 0;
+    while(getline(in, line)) {
+        num++;
+        string reason;
+        line = trim(line.substr(0, line.find('#')));
+        if(line.empty()) {
+            continue;
+        }
+        size_t eq = line.find('=');
+        if(line.size() > SCENARIO_MAX_LINE) {
+            reason = "line too long";
+        } else if(eq == string::npos) {
+            reason = "expected key = value";
+        } else if(apply_entry(trim(line.substr(0, eq)), trim(line.substr(eq + 1)), dir, cfg, sc, &reason)) {
+            continue;
+        }
+        ostringstream msg;
+        msg << path << ":" << num << ": " << reason;
+        *err = msg.str();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Scans a fleet manifest in place: one company name or number per line, blank
+ *        lines and '#' comments are skipped.
+ *
+ * @param data Manifest text.
+ * @param n Size of the text.
+ * @param out Filled with the company of every aircraft.
+ * @param bad_line Filled with the first invalid line.
+ *
+ * @return True if every line was valid.
+ */
+static bool scan_manifest(const char *data, size_t n, vector<uint8_t> *out, long *bad_line) {
+    const char *p = data;
+    const char *end = data + n;
+    long line = 1;
+    out->clear();
+    out->reserve(n / 6);                                        // "alpha\n", shortest names overestimate
+    while(p < end) {
+        while((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\r'))) {
+            p++;
+        }
+        if((p < end) && (*p != '\n') && (*p != '#')) {
+            const char *tok = p;
+            while((p < end) && (*p > ' ') && (*p != '#')) {
+                p++;
+            }
+            int c = company_index(tok, p - tok);
+            while((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\r'))) {
+                p++;
+            }
+            if((c < 0) || ((p < end) && (*p != '\n') && (*p != '#'))) {
+                *bad_line = line;
+                return false;
+            }
+            out->push_back((uint8_t)c);
+        }
+        p = (const char *)memchr(p, '\n', end - p);             // rest of the line is a comment
+        if(!p) {
+            break;
+        }
+        p++;
+        line++;
+    }
+    return true;
+}
+
+/**
+ * @brief Loads an explicit fleet manifest. Regular files are memory mapped and scanned
+ *        without copying, anything else (e.g. a pipe) is read into memory first.
+ *
+ * @param path Manifest file.
+ * @param out Filled with the company of every aircraft, in aircraft number order.
+ * @param err Filled with the reason if the manifest is invalid.
+ *
+ * @return True if the manifest is valid and lists at least one aircraft.
+ */
+bool load_fleet_manifest(const string &path, vector<uint8_t> *out, string *err) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        *err = path + ": cannot open";
+        return false;
+    }
+    long bad_line = 0;
+    bool ok = false;
+    bool scanned = false;
+    struct stat st;
+    if((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0)) {
+        void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map != MAP_FAILED) {
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            ok = scan_manifest((const char *)map, st.st_size, out, &bad_line);
+            scanned = true;
+            munmap(map, st.st_size);
+        }
+    }
+    if(!scanned) {                                              // not mappable, read it
+        vector<char> buf;
+        char chunk[1 << 16];
+        ssize_t got;
+        while((got = read(fd, chunk, sizeof(chunk))) > 0) {
+            buf.insert(buf.end(), chunk, chunk + got);
+        }
+        ok = scan_manifest(buf.data(), buf.size(), out, &bad_line);
+    }
+    close(fd);
+    if(!ok) {
+        ostringstream msg;
+        msg << path << ":" << bad_line << ": expected one company per line";
+        *err = msg.str();
+    } else if(out->empty()) {
+        *err = path + ": no aircraft";
+        ok = false;
+    }
+    return ok;
+}
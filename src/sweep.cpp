@@ -0,0 +1,226 @@
+/**
+ * @brief   Parameter Sweep file
+ * @details This file contains the parameter sweep driver for the eVtol simulation problem from Joby Avation.
+ *          A sweep spec such as "alpha=2:10:2;chargers=1,3,5;fault=0.5,1,2" is expanded into the cartesian
+ *          product of configurations, which run on the batch runner (per worker context reuse, common seeds
+ *          across points). The results are written as one CSV table, one row per point and company.
+ *
+ * @author  Deepak E Kapure
+ * @date    07-02-2025
+ *
+ */
+
+#include "../includes/sweep.hpp"
+#include <sstream>
+#include <cstdlib>
+#include <cmath>
+
+static const char *sweep_keys[TOTAL_SWEEP_PARAMS] = {
+    "alpha", "bravo", "charlie", "delta", "echo", "chargers", "fault", "downtime", "soc"
+};
+
+/**
+ * @brief Parses a number, the whole string must be consumed.
+ *
+ * @param s String to parse.
+ * @param v Filled with the value.
+ *
+ * @return True if s is a number.
+ */
+static bool parse_number(const string &s, double *v) {
+    char *end;
+    *v = strtod(s.c_str(), &end);
+    return !s.empty() && (*end == '\0') && isfinite(*v);
+}
+
+/**
+ * @brief Checks a value against the valid range of a parameter.
+ *
+ * @param p Parameter.
+ * @param v Value.
+ *
+ * @return True if valid.
+ */
+static bool valid_value(int p, double v) {
+    switch(p) {
+        case SWEEP_CHARGERS: return (v >= 1) && (v == floor(v));
+        case SWEEP_FAULT:    return (v >= 0);
+        case SWEEP_DOWNTIME: return (v >= 0);
+        case SWEEP_SOC:      return (v >= 0) && (v < 100) && (v == floor(v));
+        default:             return (v >= 0) && (v == floor(v));       // aircraft per company
+    }
+}
+
+/**
+ * @brief Parses the values of one parameter, a comma separated list or a start:end[:step] range.
+ *
+ * @param p Parameter.
+ * @param s Value string.
+ * @param out Filled with the values.
+ *
+ * @return True if the values were valid.
+ */
+static bool parse_values(int p, const string &s, vector<double> *out) {
+    out->clear();
+    if(s.find(':') != string::npos) {
+        vector<double> r;
+        stringstream ss(s);
+        string tok;
+        double v;
+        while(getline(ss, tok, ':')) {
+            if(!parse_number(tok, &v)) {
+                return false;
+            }
+            r.push_back(v);
+        }
+        double step = (r.size() == 3) ? r[2] : 1.0;
+        if((r.size() < 2) || (r.size() > 3) || (step <= 0) || (r[1] < r[0])) {
+            return false;
+        }
+        long n = (long)floor((r[1] - r[0]) / step + 1e-9);
+        for(long i=0; i<=n; i++) {
+            out->push_back(r[0] + i*step);
+        }
+    } else {
+        stringstream ss(s);
+        string tok;
+        double v;
+        while(getline(ss, tok, ',')) {
+            if(!parse_number(tok, &v)) {
+                return false;
+            }
+            out->push_back(v);
+        }
+    }
+    for(double v: *out) {
+        if(!valid_value(p, v)) {
+            return false;
+        }
+    }
+    return !out->empty();
+}
+
+/**
+ * @brief Parses a sweep spec, "key=values" entries separated by ';'.
+ *        Keys: alpha, bravo, charlie, delta, echo (aircraft per company), chargers,
+ *        fault (fault probability multiplier), downtime (hours), soc (threshold %).
+ *
+ * @param spec Sweep spec.
+ * @param sp Filled with the parsed values.
+ *
+ * @return True if the spec was valid.
+ */
+bool parse_sweep_spec(const string &spec, _sweep_spec *sp) {
+    stringstream ss(spec);
+    string entry;
+    bool any = false;
+    while(getline(ss, entry, ';')) {
+        if(entry.empty()) {
+            continue;
+        }
+        size_t eq = entry.find('=');
+        if(eq == string::npos) {
+            return false;
+        }
+        string key = entry.substr(0, eq);
+        int p = 0;
+        for(; (p < TOTAL_SWEEP_PARAMS) && (key != sweep_keys[p]); p++);
+        if((p == TOTAL_SWEEP_PARAMS) || !parse_values(p, entry.substr(eq+1), &sp->values[p])) {
+            return false;
+        }
+        any = true;
+    }
+    return any;
+}
+
+/**
+ * @brief Expands a sweep spec into the cartesian product of configurations, the last
+ *        parameter varies fastest. Points with a fixed mix of no aircraft are skipped.
+ *
+ * @param base Base configuration, used for every parameter that is not swept.
+ * @param sp Parsed sweep spec.
+ * @param points Filled with the configurations.
+ *
+ * @return None
+ */
+void build_sweep_points(const _sim_config &base, const _sweep_spec &sp, vector<_sim_config> *points) {
+    bool fixed_mix = false;
+    size_t total = 1;
+    for(int p=0; p<TOTAL_SWEEP_PARAMS; p++) {
+        fixed_mix |= ((p < TOTAL_CATEGORIES) && !sp.values[p].empty());
+        total *= max((size_t)1, sp.values[p].size());
+    }
+    points->clear();
+    points->reserve(total);
+    for(size_t n=0; n<total; n++) {
+        _sim_config cfg = base;
+        size_t rest = n;
+        for(int p=TOTAL_SWEEP_PARAMS-1; p>=0; p--) {
+            const vector<double> &v = sp.values[p];
+            if(fixed_mix && (p < TOTAL_CATEGORIES)) {
+                cfg.mix[p] = 0;
+            }
+            if(v.empty()) {
+                continue;
+            }
+            double x = v[rest % v.size()];
+            rest /= v.size();
+            switch(p) {
+                case SWEEP_CHARGERS: cfg.chargers = (int)x;          break;
+                case SWEEP_FAULT:    cfg.fault_scale = x;            break;
+                case SWEEP_DOWNTIME: cfg.downtime_hours = x;         break;
+                case SWEEP_SOC:      cfg.soc_threshold = (int)x;     break;
+                default:             cfg.mix[p] = (int)x;            break;
+            }
+        }
+        if(fixed_mix) {
+            cfg.manifest = nullptr;                     // the swept mix replaces a fleet manifest
+            cfg.aircrafts = 0;
+            for(int c=0; c<TOTAL_CATEGORIES; c++) {
+                cfg.aircrafts += cfg.mix[c];
+            }
+            if(cfg.aircrafts == 0) {
+                continue;
+            }
+        }
+        points->push_back(cfg);
+    }
+}
+
+/**
+ * @brief Writes the sweep results as CSV, one row per point and company with the point
+ *        parameters followed by the mean and 95% confidence half width of every metric.
+ *
+ * @param points Configurations of the points.
+ * @param res Aggregated results, one per point.
+ * @param out Output stream.
+ *
+ * @return None
+ */
+void write_sweep_results(const vector<_sim_config> &points, vector<_batch_result> &res, ostream &out) {
+    out << "point,aircrafts,chargers,fault_scale,downtime_hours,soc_threshold,company,company_aircrafts,replications,"
+        << "flights,flights_ci95,avg_flight_time,avg_flight_time_ci95,avg_distance,avg_distance_ci95,"
+        << "avg_charge_time,avg_charge_time_ci95,total_faults,total_faults_ci95,passenger_miles,passenger_miles_ci95\n";
+    for(size_t n=0; n<points.size(); n++) {
+        const _sim_config &cfg = points[n];
+        for(int c=0; c<TOTAL_CATEGORIES; c++) {
+            out << n << "," << cfg.aircrafts << "," << cfg.chargers << "," << cfg.fault_scale << ","
+                << cfg.downtime_hours << "," << cfg.soc_threshold << "," << company_name(c) << ",";
+            if(cfg.mix[c] > 0) {
+                out << cfg.mix[c];
+            } else {
+                bool fixed = false;
+                for(int k=0; k<TOTAL_CATEGORIES; k++) {
+                    fixed |= (cfg.mix[k] > 0);
+                }
+                out << (fixed ? "0" : "random");
+            }
+            out << "," << res[n].replications;
+            for(int k=0; k<TOTAL_METRICS; k++) {
+                running_stats &s = res[n].series[c][k].stats;
+                out << "," << s.mean() << "," << s.ci95();
+            }
+            out << "\n";
+        }
+    }
+}
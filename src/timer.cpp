@@ -1,35 +1,178 @@
 /**
- * @brief   Timer file  
+ * @brief   Timer file
  * @details This file contains the timer functions for the eVtol simulation problem from Joby Avation.
- * 
+ *          The timer keeps the simulation clock of the wall-clock paced run. The clock runs at a
+ *          configurable rate of simulation msec per wall msec, or free running it jumps straight to
+ *          the next service deadline so the services run back to back. The periodic services are
+ *          registered here, the service loop sleeps on an absolute monotonic deadline until the
+ *          earliest one is due instead of polling the clock. The fleet reports every step it
+ *          takes, the difference to the clock is the drift of a host that can't keep up.
+ *
  * @author  Deepak E Kapure
- * @date    07-02-2025 
- * 
+ * @date    07-02-2025
+ *
  */
 
 #include "../includes/timer.hpp"
+#include <algorithm>
+#include <vector>
+#include <cerrno>
+#include <time.h>
 
-// Time keeping variables 
-static time_point<high_resolution_clock> refernce_pt;
+/**
+ * @brief Periodic service timer.
+ *
+ * @var interval Service interval in simulation msec.
+ * @var next Simulation time at which the service is next due.
+ */
+typedef struct SERVICE_TIMER {
+    milliseconds interval;
+    milliseconds next;
+} _service_timer;
+
+// Time keeping variables, steady_clock is CLOCK_MONOTONIC so deadlines map to clock_nanosleep
+static time_point<steady_clock> refernce_pt;
 static milliseconds counter_val;
+static double clock_rate;                      // simulation msec per wall msec, 0 free running
+static milliseconds advanced_val;              // simulation time the fleet has been stepped through
+static milliseconds max_lag_val;
+
+/**
+ * @brief Registered service timers. Function local, so services in other files can
+ *        register from their static initializers.
+ *
+ * @return Reference to the timer list.
+ */
+static std::vector<_service_timer> &service_timers(void) {
+    static std::vector<_service_timer> timers;
+    return timers;
+}
 
 /**
- * @brief Initializes the timer reference point to the current time.
+ * @brief Registers a periodic service. The service is first due one interval after init_Timer().
+ *
+ * @param interval Service interval in simulation msec.
+ *
+ * @return Timer id for timer_due().
+ */
+_timer_id timer_register(milliseconds interval) {
+    std::vector<_service_timer> &timers = service_timers();
+    timers.push_back({interval, interval});
+    return (_timer_id)timers.size() - 1;
+}
+
+/**
+ * @brief Changes the interval of a registered service, e.g. one set by the run configuration.
+ *        Takes effect from the next init_Timer().
+ *
+ * @param id Timer id from timer_register().
+ * @param interval Service interval in simulation msec.
  *
  * @return None
  */
-void init_Timer(void) {
-    refernce_pt = high_resolution_clock::now();
+void timer_set_interval(_timer_id id, milliseconds interval) {
+    service_timers()[id].interval = interval;
 }
 
 /**
- * @brief Updates the global counter with elapsed milliseconds since reference.
+ * @brief Checks if a service is due and if so rearms it one interval from now, so a late
+ *        service keeps its interval instead of catching up.
+ *
+ * @param id Timer id from timer_register().
+ *
+ * @return 1 if the service is due, else 0.
+ */
+int timer_due(_timer_id id) {
+    int ret=0;
+    _service_timer *t = &service_timers()[id];
+    if(counter_val >= t->next) {
+        t->next = counter_val + t->interval;
+        ret = 1;
+    }
+    return ret;
+}
+
+/**
+ * @brief Initializes the timer reference point to the current time, resets the clock and
+ *        rearms every service timer.
+ *
+ * @param rate Simulation msec per wall msec, 0 to free run.
+ *
+ * @return None
+ */
+void init_Timer(double rate) {
+    clock_rate = std::max(rate, 0.0);
+    counter_val = milliseconds(0);
+    advanced_val = milliseconds(0);
+    max_lag_val = milliseconds(0);
+    for(auto &t: service_timers()) {
+        t.next = t.interval;
+    }
+    refernce_pt = steady_clock::now();
+}
+
+/**
+ * @brief Earliest service deadline, at most limit.
+ *
+ * @param limit Upper bound.
+ *
+ * @return Simulation time of the next deadline.
+ */
+static milliseconds next_deadline(milliseconds limit) {
+    milliseconds next = limit;
+    for(auto &t: service_timers()) {
+        next = std::min(next, t.next);
+    }
+    return next;
+}
+
+/**
+ * @brief Updates the simulation clock, scaled wall time since the reference or, free
+ *        running, the next service deadline.
  *
  * @return None
  */
 void update_Timer(void) {
-    time_point<high_resolution_clock> curr = high_resolution_clock::now();
-    counter_val = duration_cast<milliseconds>(curr - refernce_pt);
+    if(clock_rate > 0) {
+        duration<double, std::milli> wall = steady_clock::now() - refernce_pt;
+        counter_val = milliseconds((long)(wall.count() * clock_rate));
+    } else {
+        counter_val = std::max(counter_val + milliseconds(1), next_deadline(milliseconds::max()));
+    }
+}
+
+/**
+ * @brief Sleeps until the earliest service is due or the clock reaches limit. Uses an
+ *        absolute CLOCK_MONOTONIC deadline, so the wake up does not drift with the time
+ *        spent in the services. Returns at once when free running or already late.
+ *
+ * @param limit Simulation time to wake up at the latest, e.g. the end of the run.
+ *
+ * @return None
+ */
+void timer_wait(milliseconds limit) {
+    if(clock_rate > 0) {
+        milliseconds next = next_deadline(limit);
+        if(next > counter_val) {
+            nanoseconds wake = (refernce_pt + timer_wall_time(next) + microseconds(1)).time_since_epoch();  // past the rounding of the clock
+            struct timespec ts;
+            ts.tv_sec = (time_t)duration_cast<seconds>(wake).count();
+            ts.tv_nsec = (long)(wake.count() % 1000000000L);
+            while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+            }
+        }
+    }
+}
+
+/**
+ * @brief Converts simulation time to wall time at the current rate.
+ *
+ * @param sim Simulation time.
+ *
+ * @return Wall time, 0 when free running.
+ */
+nanoseconds timer_wall_time(milliseconds sim) {
+    return (clock_rate > 0) ? duration_cast<nanoseconds>(duration<double, std::milli>(sim.count() / clock_rate)) : nanoseconds(0);
 }
 
 /**
@@ -73,4 +216,35 @@ void get_counter_val(milliseconds *m) {
     }
 }
 
+/**
+ * @brief Records that the fleet was stepped through step of simulation time. A step
+ *        always covers a fixed interval, so a host that can't keep up falls behind the clock.
+ *
+ * @param step Simulation time of the step.
+ *
+ * @return None
+ */
+void timer_advanced(milliseconds step) {
+    advanced_val += step;
+    max_lag_val = std::max(max_lag_val, counter_val - advanced_val);
+}
 
+/**
+ * @brief Reports the pacing of the run so far.
+ *
+ * @param d Pointer to the drift report to fill.
+ *
+ * @return None
+ */
+void get_timer_drift(_timer_drift *d) {
+    if(d) {
+        duration<double, std::milli> wall = steady_clock::now() - refernce_pt;
+        d->rate = clock_rate;
+        d->wall_ms = wall.count();
+        d->achieved = (d->wall_ms > 0) ? (advanced_val.count() / d->wall_ms) : 0.0;
+        d->clock = counter_val;
+        d->advanced = advanced_val;
+        d->lag = std::max(counter_val - advanced_val, milliseconds(0));
+        d->max_lag = max_lag_val;
+    }
+}
@@ -0,0 +1,106 @@
+/**
+ * @brief   Worker Pool file
+ * @details This file contains the worker pool used to step the aircraft fleet for the eVtol simulation problem
+ *          from Joby Avation. The fleet is split in contiguous slices, each worker steps one slice per job.
+ *
+ * @author  Deepak E Kapure
+ * @date    07-02-2025
+ *
+ */
+
+#include "../includes/worker_pool.hpp"
+
+/**
+ * @brief Starts the worker threads.
+ *
+ * @param n Number of workers (at least 1).
+ */
+worker_pool::worker_pool(int n) : count((n < 1) ? 1 : n), total(0), generation(0), pending(0), stop(false) {
+    workers.reserve(count);
+    for(int id=0; id<count; id++) {
+        workers.emplace_back(&worker_pool::worker_loop, this, id);
+    }
+}
+
+/**
+ * @brief Stops and joins the worker threads.
+ */
+worker_pool::~worker_pool() {
+    {
+        lock_guard<mutex> guard(lock);
+        stop = true;
+    }
+    start_cv.notify_all();
+    for(auto &th: workers) {
+        th.join();
+    }
+}
+
+/**
+ * @brief Worker thread body. Sleeps until a job is posted, runs its slice and
+ *        reports completion.
+ *
+ * @param id Worker index, selects the slice of the job.
+ *
+ * @return None
+ */
+void worker_pool::worker_loop(int id) {
+    unsigned long seen = 0;
+    while(true) {
+        function<void(int, int)> fn;
+        int items;
+        {
+            unique_lock<mutex> guard(lock);
+            start_cv.wait(guard, [&]{ return stop || (generation != seen); });
+            if(stop) {
+                break;
+            }
+            seen = generation;
+            fn = job;
+            items = total;
+        }
+        int begin = (int)((long)items * id / count);
+        int end = (int)((long)items * (id + 1) / count);
+        if(begin < end) {
+            fn(begin, end);
+        }
+        {
+            lock_guard<mutex> guard(lock);
+            if(--pending == 0) {
+                done_cv.notify_one();
+            }
+        }
+    }
+}
+
+/**
+ * @brief Runs fn over [0, items) split in contiguous slices across all workers and
+ *        blocks until every slice is done.
+ *
+ * @param items Number of work items.
+ * @param fn Function called with the [begin, end) range of each slice.
+ *
+ * @return None
+ */
+void worker_pool::parallel_for(int items, const function<void(int, int)> &fn) {
+    if(items <= 0) {
+        return;
+    }
+    unique_lock<mutex> guard(lock);
+    job = fn;
+    total = items;
+    pending = count;
+    generation++;
+    start_cv.notify_all();
+    done_cv.wait(guard, [&]{ return pending == 0; });
+}
+
+/**
+ * @brief Default worker count, one per hardware thread.
+ *
+ * @return Number of hardware threads, 1 if unknown.
+ */
+int default_worker_count(void) {
+    unsigned int n = thread::hardware_concurrency();
+    return (n > 0) ? (int)n : 1;
+}
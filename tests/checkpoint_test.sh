@@ -0,0 +1,47 @@
+#!/bin/sh
+#
+# @brief   Checkpoint test script
+# @details Checks checkpoint and restore of the eVtol simulation: a run resumed with -R from the last checkpoint
+#          written by -k must give the same aircraft results, flight data samples and analysis as the
+#          uninterrupted run, and the same run must write a byte identical checkpoint. Run by make check
+#          from a temporary directory, the logs of the repository are not touched.
+#
+# @author  Deepak E Kapure
+# @date    07-02-2025
+#
+# Usage: checkpoint_test.sh path/to/evtol_sim
+
+SIM=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+DIR=$(mktemp -d /tmp/evtol_checkpoint_XXXXXX) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "checkpoint_test: FAILED: $1"
+    exit 1
+}
+
+# uninterrupted run, checkpoints at 2 and 4 hours, the one at 4 hours is kept
+"$SIM" -n 300 -t 6 -c 4 -s 42 -k 2 > full.out || fail "run with -k"
+cp evtol_sim_log.txt full_log.txt
+cp evtol_sim_ckpt.bin first.bin
+
+"$SIM" -n 300 -t 6 -c 4 -s 42 -k 2 > /dev/null || fail "second run with -k"
+cmp -s first.bin evtol_sim_ckpt.bin || fail "the same run wrote a different checkpoint"
+
+"$SIM" -R evtol_sim_ckpt.bin > resumed.out || fail "resume with -R"
+grep -q "at 4 hours" resumed.out || fail "not resumed from the checkpoint at 4 hours"
+
+grep "^Aircraft:" full.out > full_ac.txt
+grep "^Aircraft:" resumed.out > resumed_ac.txt
+[ -s full_ac.txt ] || fail "no aircraft results"
+cmp -s full_ac.txt resumed_ac.txt || fail "aircraft results differ from the uninterrupted run"
+
+# the resumed recording starts at the checkpoint, samples and analysis follow as in the full log
+tail -n +2 evtol_sim_log.txt > resumed_log.txt
+sed -n '/^240000 /,$p' full_log.txt > full_tail.txt
+[ -s full_tail.txt ] || fail "no samples after the checkpoint"
+grep -q "^Simulation_Results:" resumed_log.txt || fail "no analysis in the resumed log"
+cmp -s full_tail.txt resumed_log.txt || fail "flight data or analysis differ from the uninterrupted run"
+
+echo "checkpoint_test: passed"
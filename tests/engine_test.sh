@@ -0,0 +1,39 @@
+#!/bin/sh
+#
+# @brief   Event engine test script
+# @details Checks that the event engine of the eVtol simulation is a pure function of the seed: the same seed
+#          must give a byte identical log and the same aircraft results whatever the number of worker threads
+#          given with -w. Run by make check from a temporary directory, the logs of the repository are not
+#          touched.
+#
+# @author  Deepak E Kapure
+# @date    07-02-2025
+#
+# Usage: engine_test.sh path/to/evtol_sim
+
+SIM=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+DIR=$(mktemp -d /tmp/evtol_engine_XXXXXX) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "engine_test: FAILED: $1"
+    exit 1
+}
+
+for w in 1 2 4; do
+    "$SIM" -n 1000 -t 6 -c 3 -s 42 -w $w > run_$w.out || fail "run with -w $w"
+    grep "^Aircraft:" run_$w.out > ac_$w.txt
+    cp evtol_sim_log.txt log_$w.txt
+done
+[ -s ac_1.txt ] || fail "no aircraft results"
+grep -q "^Simulation_Results:" log_1.txt || fail "no analysis in the log"
+for w in 2 4; do
+    cmp -s ac_1.txt ac_$w.txt || fail "aircraft results with -w $w differ from -w 1"
+    cmp -s log_1.txt log_$w.txt || fail "log with -w $w differs from -w 1"
+done
+
+"$SIM" -n 1000 -t 6 -c 3 -s 43 > other.out || fail "run with another seed"
+cmp -s log_1.txt evtol_sim_log.txt && fail "another seed gave the same log"
+
+echo "engine_test: passed"
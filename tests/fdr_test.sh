@@ -0,0 +1,43 @@
+#!/bin/sh
+#
+# @brief   Flight data recorder test script
+# @details Checks the binary flight data recordings of the eVtol simulation: a -f bin and a -f delta recording
+#          converted back by fdr_convert must give the header and sample lines of the text log of the same
+#          run exactly. Run by make check from a temporary directory, the logs of the repository are not
+#          touched.
+#
+# @author  Deepak E Kapure
+# @date    07-02-2025
+#
+# Usage: fdr_test.sh path/to/evtol_sim path/to/fdr_convert
+
+SIM=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+CONVERT=$(cd "$(dirname "$2")" && pwd)/$(basename "$2")
+DIR=$(mktemp -d /tmp/evtol_fdr_XXXXXX) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "fdr_test: FAILED: $1"
+    exit 1
+}
+
+# header and sample lines of a text log, without the analysis
+samples() {
+    sed -n '1p; /^[0-9]/p' "$1"
+}
+
+"$SIM" -n 300 -t 6 -c 3 -s 5 > text.out || fail "run with the text log"
+samples evtol_sim_log.txt > text.txt
+grep -q "^2000 " text.txt || fail "no samples in the text log"
+
+for f in bin delta; do
+    "$SIM" -n 300 -t 6 -c 3 -s 5 -f $f > $f.out || fail "run with -f $f"
+    [ -s evtol_sim_fdr.bin ] || fail "no recording with -f $f"
+    "$CONVERT" evtol_sim_fdr.bin $f.log > /dev/null || fail "conversion of the -f $f recording"
+    samples $f.log > $f.txt
+    cmp -s text.txt $f.txt || fail "converted -f $f recording differs from the text log"
+    rm -f evtol_sim_fdr.bin
+done
+
+echo "fdr_test: passed"
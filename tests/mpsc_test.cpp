@@ -0,0 +1,139 @@
+/**
+ * @brief   Charge Queue test file
+ * @details This file checks the lock-free multi-producer single-consumer queue used as the charge queue of the
+ *          eVtol simulation problem from Joby Avation: empty and full queues, wraparound of the ring buffer
+ *          and the order of the entries of concurrent producers. Run by make check.
+ *
+ * @author  Deepak E Kapure
+ * @date    07-02-2025
+ *
+ */
+
+#include "../includes/mpsc_queue.hpp"
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#define TEST_PRODUCERS          (4)
+#define TEST_ENTRIES            (100000)         // entries per producer of the concurrent test
+
+static int failures = 0;
+
+#define CHECK(cond) do { if(!(cond)) { cerr << __FILE__ << ":" << __LINE__ << ": failed: " #cond << endl; failures++; } } while(0)
+
+/**
+ * @brief A new queue and a drained one are empty, pop leaves the entry untouched.
+ */
+static void test_empty() {
+    mpsc_queue<int> q;
+    q.init(4);
+    int v = -1;
+    CHECK(q.empty());
+    CHECK(!q.pop(v));
+    CHECK(v == -1);
+    CHECK(q.size_approx() == 0);
+    CHECK(q.push(7));
+    CHECK(!q.empty());
+    CHECK(q.pop(v) && (v == 7));
+    CHECK(q.empty());
+    CHECK(!q.pop(v));
+}
+
+/**
+ * @brief The capacity is rounded up to a power of two, a full queue refuses the next
+ *        entry and takes one again as soon as one is popped.
+ */
+static void test_full() {
+    mpsc_queue<int> q;
+    q.init(3);
+    CHECK(q.capacity() == 4);
+    for(int i=0; i<4; i++) {
+        CHECK(q.push(i));
+    }
+    CHECK(!q.push(4));
+    CHECK(q.size_approx() == 4);
+    int v = -1;
+    CHECK(q.pop(v) && (v == 0));
+    CHECK(q.push(4));
+    CHECK(!q.push(5));
+    for(int i=1; i<=4; i++) {
+        CHECK(q.pop(v) && (v == i));
+    }
+    CHECK(q.empty());
+}
+
+/**
+ * @brief Entries keep their order while the positions wrap around the ring many times,
+ *        and init() resets a used queue.
+ */
+static void test_wraparound() {
+    mpsc_queue<long> q;
+    q.init(4);
+    long next_in = 0, next_out = 0, v = 0;
+    for(int round=0; round<1000; round++) {
+        for(int i=0; i<3; i++) {
+            CHECK(q.push(next_in++));
+        }
+        for(int i=0; i<3; i++) {
+            CHECK(q.pop(v) && (v == next_out));
+            next_out++;
+        }
+    }
+    CHECK(q.empty());
+    CHECK(q.push(1) && q.push(2));
+    q.init(4);
+    CHECK(q.empty());
+    CHECK(q.size_approx() == 0);
+}
+
+/**
+ * @brief Producers on their own threads push numbered entries into a small queue while
+ *        the consumer drains it: every entry arrives once and each producer's entries
+ *        arrive in the order they were pushed.
+ */
+static void test_concurrent() {
+    mpsc_queue<long> q;
+    q.init(64);
+    vector<thread> producers;
+    for(int p=0; p<TEST_PRODUCERS; p++) {
+        producers.emplace_back([&q, p]() {
+            for(long i=0; i<TEST_ENTRIES; i++) {
+                while(!q.push(((long)p << 32) | i)) {
+                    this_thread::yield();               // full, wait for the consumer
+                }
+            }
+        });
+    }
+    vector<long> next(TEST_PRODUCERS, 0);
+    long received = 0, v = 0;
+    bool ordered = true;
+    while(received < (long)TEST_PRODUCERS * TEST_ENTRIES) {
+        if(!q.pop(v)) {
+            this_thread::yield();
+            continue;
+        }
+        int p = (int)(v >> 32);
+        ordered = ordered && (p >= 0) && (p < TEST_PRODUCERS) && ((v & 0xffffffffL) == next[p]);
+        if((p >= 0) && (p < TEST_PRODUCERS)) {
+            next[p]++;
+        }
+        received++;
+    }
+    for(auto &t: producers) {
+        t.join();
+    }
+    CHECK(ordered);
+    CHECK(q.empty());
+    for(int p=0; p<TEST_PRODUCERS; p++) {
+        CHECK(next[p] == TEST_ENTRIES);
+    }
+}
+
+int main() {
+    test_empty();
+    test_full();
+    test_wraparound();
+    test_concurrent();
+    cout << "mpsc_test: " << (failures ? "FAILED" : "passed") << endl;
+    return failures ? 1 : 0;
+}
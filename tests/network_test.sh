@@ -0,0 +1,54 @@
+#!/bin/sh
+#
+# @brief   Vertiport network test script
+# @details Checks the vertiport network model of the eVtol simulation: the same seed must give the same log and
+#          aircraft results whatever the number of worker threads running the sites, and a single site network
+#          must give the results of the event engine. Run by make check from a temporary directory, the logs
+#          of the repository are not touched.
+#
+# @author  Deepak E Kapure
+# @date    07-02-2025
+#
+# Usage: network_test.sh path/to/evtol_sim
+
+SIM=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+DIR=$(mktemp -d /tmp/evtol_network_XXXXXX) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "network_test: FAILED: $1"
+    exit 1
+}
+
+# results section of the analysis, without the per site results
+results() {
+    sed -n '/^Simulation_Results:/,$p' "$1" | sed '/^Vertiport_Results:/,$d'
+}
+
+for w in 1 2 4; do
+    "$SIM" -n 3000 -t 12 -c 1 -s 7 -V 16:12 -w $w > run_$w.out || fail "run with -w $w"
+    grep -q "16 vertiports in" run_$w.out || fail "no network run with -w $w"
+    grep "^Aircraft:" run_$w.out > ac_$w.txt
+    cp evtol_sim_log.txt log_$w.txt
+done
+[ -s ac_1.txt ] || fail "no aircraft results"
+grep -q "^Vertiport_Results:" log_1.txt || fail "no vertiport results in the log"
+grep -q "Transfers: [1-9]" log_1.txt || fail "no aircraft handed over between sites"
+for w in 2 4; do
+    cmp -s ac_1.txt ac_$w.txt || fail "aircraft results with -w $w differ from -w 1"
+    cmp -s log_1.txt log_$w.txt || fail "log with -w $w differs from -w 1"
+done
+
+# one site, every flight is a local flight and the chargers are the ones of the event engine
+"$SIM" -n 400 -t 6 -c 3 -s 5 > base.out || fail "run on the event engine"
+results evtol_sim_log.txt > base.txt
+"$SIM" -n 400 -t 6 -c 3 -s 5 -V 1 > site.out || fail "run on one site"
+results evtol_sim_log.txt > site.txt
+[ -s base.txt ] || fail "no analysis"
+cmp -s base.txt site.txt || fail "one site analysis differs from the event engine"
+grep "^Aircraft:" base.out > base_ac.txt
+grep "^Aircraft:" site.out > site_ac.txt
+cmp -s base_ac.txt site_ac.txt || fail "one site aircraft results differ from the event engine"
+
+echo "network_test: passed"
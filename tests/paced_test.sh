@@ -0,0 +1,35 @@
+#!/bin/sh
+#
+# @brief   Paced mode test script
+# @details Checks the paced mode of the eVtol simulation run as fast as possible: the same seed must give the
+#          same log and aircraft results whatever the number of worker threads stepping the fleet. Run by
+#          make check from a temporary directory, the logs of the repository are not touched.
+#
+# @author  Deepak E Kapure
+# @date    07-02-2025
+#
+# Usage: paced_test.sh path/to/evtol_sim
+
+SIM=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+DIR=$(mktemp -d /tmp/evtol_paced_XXXXXX) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+fail() {
+    echo "paced_test: FAILED: $1"
+    exit 1
+}
+
+for w in 1 2 4; do
+    "$SIM" -n 400 -t 6 -c 3 -s 11 -x max -w $w > run_$w.out || fail "run with -w $w"
+    grep "^Aircraft:" run_$w.out > ac_$w.txt
+    cp evtol_sim_log.txt log_$w.txt
+done
+[ -s ac_1.txt ] || fail "no aircraft results"
+grep -q "^Simulation_Results:" log_1.txt || fail "no analysis in the log"
+for w in 2 4; do
+    cmp -s ac_1.txt ac_$w.txt || fail "aircraft results with -w $w differ from -w 1"
+    cmp -s log_1.txt log_$w.txt || fail "log with -w $w differs from -w 1"
+done
+
+echo "paced_test: passed"
@@ -0,0 +1,70 @@
+/**
+ * @brief   Philox test file
+ * @details This file checks the counter based random number generator of the eVtol simulation problem from
+ *          Joby Avation against the known answer of Philox4x32-10 from the Random123 library, and that a
+ *          stream is a pure function of seed and stream id. Run by make check.
+ *
+ * @author  Deepak E Kapure
+ * @date    07-02-2025
+ *
+ */
+
+#include "../includes/philox.hpp"
+#include <iostream>
+
+#define TEST_DRAWS              (1000)           // draws per stream of the stream tests
+
+static int failures = 0;
+
+#define CHECK(cond) do { if(!(cond)) { cerr << __FILE__ << ":" << __LINE__ << ": failed: " #cond << endl; failures++; } } while(0)
+
+/**
+ * @brief Key and counter 0 give the Random123 known answer of Philox4x32-10.
+ */
+static void test_known_answer() {
+    philox_rng rng(0, 0);
+    const uint32_t kat[4] = {0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u};
+    for(int i=0; i<4; i++) {
+        CHECK(rng.next_u32() == kat[i]);
+    }
+}
+
+/**
+ * @brief A restarted stream repeats its sequence, other seeds and streams do not.
+ */
+static void test_streams() {
+    philox_rng a(42, 7), b(1, 1), c(42, 8), d(43, 7);
+    b.set_stream(42, 7);
+    int same_stream = 0, other_stream = 0, other_seed = 0;
+    for(int i=0; i<TEST_DRAWS; i++) {
+        uint32_t v = a.next_u32();
+        same_stream += (v == b.next_u32());
+        other_stream += (v == c.next_u32());
+        other_seed += (v == d.next_u32());
+    }
+    CHECK(same_stream == TEST_DRAWS);
+    CHECK(other_stream < 4);
+    CHECK(other_seed < 4);
+}
+
+/**
+ * @brief uniform() stays in [0, 1) and below(n) in [0, n).
+ */
+static void test_ranges() {
+    philox_rng rng(7, 3);
+    bool in_range = true;
+    for(int i=0; i<TEST_DRAWS; i++) {
+        double u = rng.uniform();
+        uint32_t k = rng.below(10);
+        in_range = in_range && (u >= 0.0) && (u < 1.0) && (k < 10);
+    }
+    CHECK(in_range);
+}
+
+int main() {
+    test_known_answer();
+    test_streams();
+    test_ranges();
+    cout << "philox_test: " << (failures ? "FAILED" : "passed") << endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+/**
+ * @brief   Scenario test file
+ * @details This file checks the scenario file loader of the eVtol simulation problem from Joby Avation: a valid
+ *          file sets the configuration, company specifications and fleet manifest, and an invalid line is
+ *          reported as file:line with the reason. Run by make check.
+ *
+ * @author  Deepak E Kapure
+ * @date    07-02-2025
+ *
+ */
+
+#include "../includes/scenario.hpp"
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { if(!(cond)) { cerr << __FILE__ << ":" << __LINE__ << ": failed: " #cond << endl; failures++; } } while(0)
+
+/**
+ * @brief Writes a text file.
+ */
+static void write_file(const string &path, const string &text) {
+    ofstream out(path, ios::out | ios::trunc);
+    out << text;
+}
+
+/**
+ * @brief Loads a scenario on the default configuration.
+ *
+ * @return True if the file was valid, err holds the message otherwise.
+ */
+static bool load(const string &path, _sim_config *cfg, _scenario *sc, string *err) {
+    default_sim_config(cfg);
+    init_scenario(sc);
+    err->clear();
+    return load_scenario(path, cfg, sc, err);
+}
+
+/**
+ * @brief A valid scenario with comments, blank lines and a manifest next to it.
+ */
+static void test_valid(const string &dir) {
+    write_file(dir + "/fleet.txt", "alpha\n# spare\n\n4\necho\n");
+    write_file(dir + "/ok.txt",
+               "# scenario\n"
+               "chargers = 5\n"
+               "\n"
+               "charger_power = 1.5   # faster chargers\n"
+               "policy = scf\n"
+               "hours = 2.5\n"
+               "echo.fault = 0.05\n"
+               "sites = 16\n"
+               "site_miles = 12\n"
+               "manifest = fleet.txt\n");
+    _sim_config cfg;
+    _scenario sc;
+    string err;
+    CHECK(load(dir + "/ok.txt", &cfg, &sc, &err));
+    CHECK(err.empty());
+    CHECK(cfg.chargers == 5);
+    CHECK(cfg.charger_power == 1.5);
+    CHECK(cfg.policy == DISPATCH_SHORTEST_CHARGE);
+    CHECK(cfg.sim_hours == 2.5);
+    CHECK(sc.probs[ECHO] == 0.05);
+    CHECK(cfg.sites == 16);
+    CHECK(cfg.site_miles == 12);
+    CHECK(cfg.aircrafts == 3);
+    CHECK((sc.manifest.size() == 3) && (sc.manifest[0] == ALPHA) && (sc.manifest[1] == ECHO) && (sc.manifest[2] == ECHO));
+}
+
+/**
+ * @brief Invalid lines are reported with the file, the line number and the reason.
+ */
+static void test_errors(const string &dir) {
+    _sim_config cfg;
+    _scenario sc;
+    string err;
+    string path = dir + "/bad.txt";
+
+    write_file(path, "# scenario\nchargers = 5\n\nchargers = none\n");
+    CHECK(!load(path, &cfg, &sc, &err));
+    CHECK(err == path + ":4: invalid value 'none' for 'chargers'");
+
+    write_file(path, "speed = 100\n");
+    CHECK(!load(path, &cfg, &sc, &err));
+    CHECK(err == path + ":1: unknown key 'speed'");
+
+    write_file(path, "aircrafts = 10\nchargers 5\n");
+    CHECK(!load(path, &cfg, &sc, &err));
+    CHECK(err == path + ":2: expected key = value");
+
+    write_file(path, "zulu.speed = 100\n");
+    CHECK(!load(path, &cfg, &sc, &err));
+    CHECK(err == path + ":1: invalid company specification 'zulu.speed'");
+
+    write_file(dir + "/bad_fleet.txt", "alpha\nzulu\n");
+    write_file(path, "chargers = 4\nmanifest = bad_fleet.txt\n");
+    CHECK(!load(path, &cfg, &sc, &err));
+    CHECK(err == path + ":2: " + dir + "/bad_fleet.txt:2: expected one company per line");
+
+    CHECK(!load(dir + "/missing.txt", &cfg, &sc, &err));
+    CHECK(err == dir + "/missing.txt: cannot open");
+}
+
+int main() {
+    char tmpl[] = "/tmp/evtol_scenario_XXXXXX";
+    if(!mkdtemp(tmpl)) {
+        cerr << "scenario_test: cannot create a temporary directory" << endl;
+        return 1;
+    }
+    string dir = tmpl;
+    test_valid(dir);
+    test_errors(dir);
+    for(const char *f: {"/fleet.txt", "/ok.txt", "/bad.txt", "/bad_fleet.txt"}) {
+        unlink((dir + f).c_str());
+    }
+    rmdir(dir.c_str());
+    cout << "scenario_test: " << (failures ? "FAILED" : "passed") << endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,228 @@
+/**
+ * @brief   Flight Data Recorder converter
+ * @details Reader for the binary flight data recorder format written by evtol_sim (-f bin / -f delta).
+ *          Converts a binary recording to the text log layout of the simulator, one line per sample,
+ *          or to CSV with one row per aircraft per sample.
+ *          Usage: fdr_convert [-csv] <evtol_sim_fdr.bin> [output]
+ *
+ * @author  Deepak E Kapure
+ * @date    07-02-2025
+ *
+ */
+
+#include "../includes/fdr_format.hpp"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Contents of the binary file header section.
+ *
+ * @var hdr File header.
+ * @var cols Column descriptors.
+ * @var companies Company names.
+ * @var company Company index of each aircraft.
+ * @var sample_size Size of one sample in bytes.
+ */
+typedef struct FDR_SCHEMA {
+    _fdr_file_header hdr;
+    vector<_fdr_column_desc> cols;
+    vector<string> companies;
+    vector<uint8_t> company;
+    size_t sample_size;
+} _fdr_schema;
+
+/**
+ * @brief Reads and validates the header section of a binary recording.
+ *
+ * @param in Input file.
+ * @param s Schema to fill.
+ *
+ * @return True if the header is valid.
+ */
+static bool read_schema(FILE *in, _fdr_schema *s) {
+    if(fread(&s->hdr, sizeof(s->hdr), 1, in) != 1) {
+        return false;
+    }
+    if((memcmp(s->hdr.magic, FDR_MAGIC, FDR_MAGIC_LEN) != 0) || (s->hdr.version != FDR_VERSION)) {
+        return false;
+    }
+    s->cols.resize(s->hdr.columns);
+    if(fread(s->cols.data(), sizeof(_fdr_column_desc), s->hdr.columns, in) != s->hdr.columns) {
+        return false;
+    }
+    s->sample_size = sizeof(int64_t);
+    for(auto &col: s->cols) {
+        col.name[FDR_NAME_LEN - 1] = '\0';
+        if((col.width != 1) && (col.width != 4) && (col.width != 8)) {
+            return false;
+        }
+        s->sample_size += (size_t)col.width * s->hdr.aircrafts;
+    }
+    for(uint32_t i=0; i<s->hdr.companies; i++) {
+        char name[FDR_NAME_LEN];
+        if(fread(name, FDR_NAME_LEN, 1, in) != 1) {
+            return false;
+        }
+        name[FDR_NAME_LEN - 1] = '\0';
+        s->companies.push_back(name);
+    }
+    s->company.resize(s->hdr.aircrafts);
+    return fread(s->company.data(), 1, s->hdr.aircrafts, in) == s->hdr.aircrafts;
+}
+
+/**
+ * @brief Loads a signed value with the given width.
+ *
+ * @param src Source, may be unaligned.
+ * @param width Width in bytes (1, 4 or 8).
+ *
+ * @return Value.
+ */
+static int64_t get_value(const char *src, int width) {
+    if(width == 1) {
+        int8_t n;
+        memcpy(&n, src, 1);
+        return n;
+    } else if(width == 4) {
+        int32_t n;
+        memcpy(&n, src, 4);
+        return n;
+    }
+    int64_t n;
+    memcpy(&n, src, 8);
+    return n;
+}
+
+/**
+ * @brief Finds a column by name.
+ *
+ * @return Column index, -1 if the recording does not have it.
+ */
+static int find_column(const _fdr_schema &s, const char *name) {
+    for(size_t c=0; c<s.cols.size(); c++) {
+        if(strcmp(s.cols[c].name, name) == 0) {
+            return (int)c;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Prints one column value, fixed point columns with 4 decimals like the text recorder.
+ */
+static void print_value(FILE *out, const _fdr_schema &s, const vector<int64_t> &values, int col, int ac, bool as_double) {
+    if(col < 0) {
+        fprintf(out, "0");
+        return;
+    }
+    int64_t v = values[(size_t)col * s.hdr.aircrafts + ac];
+    if(s.cols[col].fixed) {
+        fprintf(out, "%.4f", (double)v / s.hdr.scale);
+    } else if(as_double) {
+        fprintf(out, "%.4f", (double)v);
+    } else {
+        fprintf(out, "%lld", (long long)v);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bool csv = false;
+    int arg = 1;
+    if((arg < argc) && (strcmp(argv[arg], "-csv") == 0)) {
+        csv = true;
+        arg++;
+    }
+    if(arg >= argc) {
+        fprintf(stderr, "Usage: %s [-csv] <evtol_sim_fdr.bin> [output]\n", argv[0]);
+        return 1;
+    }
+    FILE *in = fopen(argv[arg], "rb");
+    if(!in) {
+        fprintf(stderr, "Cannot open %s\n", argv[arg]);
+        return 1;
+    }
+    FILE *out = (arg + 1 < argc) ? fopen(argv[arg + 1], "w") : stdout;
+    if(!out) {
+        fprintf(stderr, "Cannot open %s\n", argv[arg + 1]);
+        fclose(in);
+        return 1;
+    }
+
+    _fdr_schema s;
+    if(!read_schema(in, &s)) {
+        fprintf(stderr, "%s is not a flight data recorder file (version %d)\n", argv[arg], FDR_VERSION);
+        fclose(in);
+        if(out != stdout) { fclose(out); }
+        return 1;
+    }
+    int size = (int)s.hdr.aircrafts;
+    // text log column order
+    const char *order[] = { "Status", "Flight_time", "Miles_travelled", "Battery_soc", "Charger_id",
+                            "Charge_time", "Fault_count", "Charge_sessions" };
+    const int total = sizeof(order) / sizeof(order[0]);
+    int col_of[total];
+    for(int i=0; i<total; i++) {
+        col_of[i] = find_column(s, order[i]);
+    }
+
+    if(csv) {
+        fprintf(out, "Timestamp,Aircraft_num,Company");
+        for(int i=0; i<total; i++) { fprintf(out, ",%s", order[i]); }
+        fprintf(out, "\n");
+    } else {
+        fprintf(out, "Timestamp");
+        for(int ac=0; ac<size; ac++) {
+            fprintf(out, " Aircraft_num Company");
+            for(int i=0; i<total; i++) { fprintf(out, " %s", order[i]); }
+            fprintf(out, " ");
+        }
+        fprintf(out, "\n");
+    }
+
+    vector<char> sample(s.sample_size);
+    vector<int64_t> values(s.cols.size() * size, 0);    // running values, delta columns accumulate
+    long samples = 0;
+    while(fread(sample.data(), s.sample_size, 1, in) == 1) {
+        const char *src = sample.data();
+        int64_t stamp = get_value(src, 8);
+        src += sizeof(int64_t);
+        for(size_t c=0; c<s.cols.size(); c++) {
+            int width = s.cols[c].width;
+            int64_t *v = &values[c * size];
+            for(int ac=0; ac<size; ac++) {
+                int64_t n = get_value(src, width);
+                v[ac] = (s.cols[c].encoding == FDR_DELTA) ? (v[ac] + n) : n;
+                src += width;
+            }
+        }
+        if(!csv) {
+            fprintf(out, "%lld ", (long long)stamp);
+        }
+        for(int ac=0; ac<size; ac++) {
+            const char *company = (s.company[ac] < s.companies.size()) ? s.companies[s.company[ac]].c_str() : "?";
+            if(csv) {
+                fprintf(out, "%lld,%d,%s", (long long)stamp, ac, company);
+            } else {
+                fprintf(out, "%d %s", ac, company);
+            }
+            for(int i=0; i<total; i++) {
+                fprintf(out, csv ? "," : " ");
+                print_value(out, s, values, col_of[i], ac, !csv && (strcmp(order[i], "Fault_count") == 0));
+            }
+            fprintf(out, csv ? "\n" : " ");
+        }
+        if(!csv) {
+            fprintf(out, "\n");
+        }
+        samples++;
+    }
+    fprintf(stderr, "%ld samples, %d aircrafts\n", samples, size);
+
+    fclose(in);
+    if(out != stdout) { fclose(out); }
+    return 0;
+}